@@ -12,7 +12,38 @@ void UBaseHeightfield::CalculateWidthDepthHeight()
 	Height = FMath::RoundFromZero(BoundExtension.Z / CellHeight);
 }
 
-int UBaseHeightfield::GetGridIndex(const int WidthIndex, const int DepthIndex)
+void UBaseHeightfield::ResetOccupiedRows()
+{
+	RowWidthMin.Init(Width, Depth);
+	RowWidthMax.Init(-1, Depth);
+	OccupiedDepthMin = Depth;
+	OccupiedDepthMax = -1;
+}
+
+void UBaseHeightfield::MarkOccupiedCells(const int WidthMin, const int DepthMin, const int WidthMax, const int DepthMax)
+{
+	const int ClampedWidthMin = FMath::Max(WidthMin, 0);
+	const int ClampedWidthMax = FMath::Min(WidthMax, Width - 1);
+	const int ClampedDepthMin = FMath::Max(DepthMin, 0);
+	const int ClampedDepthMax = FMath::Min(DepthMax, Depth - 1);
+
+	//The rectangle is empty or outside of the grid
+	if (ClampedWidthMin > ClampedWidthMax || ClampedDepthMin > ClampedDepthMax)
+	{
+		return;
+	}
+
+	for (int DepthIndex = ClampedDepthMin; DepthIndex <= ClampedDepthMax; DepthIndex++)
+	{
+		RowWidthMin[DepthIndex] = FMath::Min(RowWidthMin[DepthIndex], ClampedWidthMin);
+		RowWidthMax[DepthIndex] = FMath::Max(RowWidthMax[DepthIndex], ClampedWidthMax);
+	}
+
+	OccupiedDepthMin = FMath::Min(OccupiedDepthMin, ClampedDepthMin);
+	OccupiedDepthMax = FMath::Max(OccupiedDepthMax, ClampedDepthMax);
+}
+
+int UBaseHeightfield::GetGridIndex(const int WidthIndex, const int DepthIndex) const
 {
 	if (WidthIndex < 0 || DepthIndex < 0 || WidthIndex >= Width || DepthIndex >= Depth)
 	{
@@ -23,16 +54,16 @@ int UBaseHeightfield::GetGridIndex(const int WidthIndex, const int DepthIndex)
 	return DepthIndex * Width + WidthIndex;
 }
 
-int UBaseHeightfield::GetDirOffSetWidth(const int Direction)
+int UBaseHeightfield::GetDirOffSetWidth(const int Direction) const
 {
-	TArray<int> Offset = { -1, 0, 1, 0 };
+	static const int Offset[4] = { -1, 0, 1, 0 };
 
 	return Offset[Direction & 0X03];
 }
 
-int UBaseHeightfield::GetDirOffSetDepth(const int Direction)
+int UBaseHeightfield::GetDirOffSetDepth(const int Direction) const
 {
-	TArray<int> Offset = { 0, -1, 0, 1 };
+	static const int Offset[4] = { 0, -1, 0, 1 };
 
 	return Offset[Direction & 0X03];
 }
@@ -17,15 +17,35 @@ public:
 	void CalculateWidthDepthHeight();
 
 	//Retrieve the grid index of a specific voxel based on its width and depth
-	int GetGridIndex(const int WidthIndex, const int DepthIndex);
+	int GetGridIndex(const int WidthIndex, const int DepthIndex) const;
 
 	//Retrieve the adjacent grid location to a cell width 
-	int GetDirOffSetWidth(const int Direction);
+	int GetDirOffSetWidth(const int Direction) const;
 
 	//Retrieve the adjacent grid location to a cell depth 
-	int GetDirOffSetDepth(const int Direction);
+	int GetDirOffSetDepth(const int Direction) const;
+
+	//Mark every row as empty, to be called once the width and depth of the heightfield are known
+	void ResetOccupiedRows();
+
+	//Extend the occupied range of the rows to include the rectangle of cells passed in (max included), the cells outside of the grid are ignored
+	void MarkOccupiedCells(const int WidthMin, const int DepthMin, const int WidthMax, const int DepthMax);
+
+	const int GetWidth() const { return Width; };
+	const int GetDepth() const { return Depth; };
 
 protected:
+	//First and last column of every row that can contain spans, used by the per cell passes to skip the empty cells of the grid
+	//The empty rows have a first column greater than the last one
+	TArray<int> RowWidthMin;
+
+	TArray<int> RowWidthMax;
+
+	//First and last row that can contain spans
+	int OccupiedDepthMin = 0;
+
+	int OccupiedDepthMax = -1;
+
 	//Width of the solid heightfield in voxels
 	int Width;
 
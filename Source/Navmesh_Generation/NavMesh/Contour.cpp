@@ -27,105 +27,95 @@ void UContour::GenerateContour(const UOpenHeightfield* OpenHeightfield)
 
 	FindNeighborRegionConnection(OpenHeightfield, DiscardedCountour);
 
-	for (auto Span : OpenHeightfield->GetSpans())
-	{
-		UOpenSpan* CurrentSpan = Span.Value;
+	const TArray<int>& RegionIDs = OpenHeightfield->GetRegionIDs();
 
-		do
+	for (int SpanIndex = 0; SpanIndex < RegionIDs.Num(); SpanIndex++)
+	{
+		//If span belongs to the null region or has no neighbor connected to another one, skip it 
+		if (RegionIDs[SpanIndex] == NULL_REGION || NeighborRegionFlags[SpanIndex] == 0)
 		{
-			//If span belongs to the null region or has no neighbor connected to another one, skip it 
-			if (CurrentSpan->RegionID == NULL_REGION || !CurrentSpan->CheckNeighborRegionFlag())
-			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
-			}
-
-			TArray<FContourVertexData> TempRawVertices;
-			TArray<FContourVertexData> TempSimplifiedVertices;
+			continue;
+		}
 
-			int NeighborDir = 0;
-			bool OnlyNullRegionConnected = true;
+		TArray<FContourVertexData> TempRawVertices;
+		TArray<FContourVertexData> TempSimplifiedVertices;
 
-			//Make sure the neighbor considered reside in another region, otherwise switch direction until it is
-			while (!CurrentSpan->GetNeighborRegionFlag(NeighborDir))
-			{
-				NeighborDir++;
-			}
+		int NeighborDir = 0;
+		bool OnlyNullRegionConnected = true;
 
-			BuildRawContours(CurrentSpan, NeighborDir, OnlyNullRegionConnected, TempRawVertices);
-			BuildSimplifiedCountour(CurrentSpan->RegionID, OnlyNullRegionConnected, TempRawVertices, TempSimplifiedVertices);
+		//Make sure the neighbor considered reside in another region, otherwise switch direction until it is
+		while (!(NeighborRegionFlags[SpanIndex] & (1 << NeighborDir)))
+		{
+			NeighborDir++;
+		}
 
-			//Add the vertices from the temporary container to the general one
-			for (FContourVertexData Vertex : TempSimplifiedVertices)
-			{
-				SimplifiedVertices.Add(Vertex);
-			}
+		BuildRawContours(OpenHeightfield, SpanIndex, NeighborDir, OnlyNullRegionConnected, TempRawVertices);
+		BuildSimplifiedCountour(RegionIDs[SpanIndex], OnlyNullRegionConnected, TempRawVertices, TempSimplifiedVertices);
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+		//Add the vertices from the temporary container to the general one
+		for (FContourVertexData Vertex : TempSimplifiedVertices)
+		{
+			SimplifiedVertices.Add(Vertex);
+		}
 	}
 }
 
 void UContour::FindNeighborRegionConnection(const UOpenHeightfield* OpenHeightfield, int& NumberOfContourDiscarded)
 {
-	for (auto Span : OpenHeightfield->GetSpans())
-	{
-		UOpenSpan* CurrentSpan = Span.Value;
+	const TArray<int>& RegionIDs = OpenHeightfield->GetRegionIDs();
+	NeighborRegionFlags.Init(0, RegionIDs.Num());
 
-		do 
+	for (int SpanIndex = 0; SpanIndex < RegionIDs.Num(); SpanIndex++)
+	{
+		//If the span considered is part of the null region, skip it
+		if (RegionIDs[SpanIndex] == NULL_REGION)
 		{
-			//If the span considered is part of the null region, skip it
-			if (CurrentSpan->RegionID == NULL_REGION)
-			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
-			}
-
-			int DiffNeighborID = 0;
+			continue;
+		}
 
-			//Iterate through the neighbor span
-			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
-			{
-				int NeighborRegionID = NULL_REGION;
-				UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
+		int DiffNeighborID = 0;
 
-				if (NeighborSpan)
-				{
-					NeighborRegionID = NeighborSpan->RegionID;
-				}
+		//Iterate through the neighbor span
+		for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+		{
+			int NeighborRegionID = NULL_REGION;
+			int NeighborSpan = OpenHeightfield->GetAxisNeighbor(SpanIndex, NeighborDir);
 
-				//If the current span region ID is different from the neighbor one
-				//It means the neighbor is not in the same region and therefore is processable for the contour generation
-				if (CurrentSpan->RegionID != NeighborRegionID)
-				{
-					CurrentSpan->NeighborInDiffRegion[NeighborDir] = true;
-					DiffNeighborID++;
-				}
+			if (NeighborSpan != NULL_OPEN_SPAN)
+			{
+				NeighborRegionID = RegionIDs[NeighborSpan];
 			}
 
-			//If all the neighbors are part of a different region, the span considered is an island span
-			//No need to process it for the contour generation
-			if (DiffNeighborID == 4)
+			//If the current span region ID is different from the neighbor one
+			//It means the neighbor is not in the same region and therefore is processable for the contour generation
+			if (RegionIDs[SpanIndex] != NeighborRegionID)
 			{
-				CurrentSpan->ResetNeighborRegionFlag();
-				NumberOfContourDiscarded++;
+				NeighborRegionFlags[SpanIndex] |= 1 << NeighborDir;
+				DiffNeighborID++;
 			}
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+		//If all the neighbors are part of a different region, the span considered is an island span
+		//No need to process it for the contour generation
+		if (DiffNeighborID == 4)
+		{
+			NeighborRegionFlags[SpanIndex] = 0;
+			NumberOfContourDiscarded++;
+		}
 	}
 }
 
-void UContour::BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyNullRegionConnection, TArray<FContourVertexData>& VerticesRaw)
+void UContour::BuildRawContours(const UOpenHeightfield* OpenHeightfield, const int SpanIndex, const int StartDir, bool& OnlyNullRegionConnection, TArray<FContourVertexData>& VerticesRaw)
 {
+	const TArray<int>& RegionIDs = OpenHeightfield->GetRegionIDs();
+	const FOpenSpan& StartSpan = OpenHeightfield->GetSpans()[SpanIndex];
+
 	int IndexRaw = 0;
 
-	UOpenSpan* CurrentSpan = Span;
+	int CurrentSpan = SpanIndex;
 	int Direction = StartDir;
-	int StartWidth = CurrentSpan->Width;
-	int StartDepth = CurrentSpan->Depth;
+	int StartWidth = StartSpan.Width;
+	int StartDepth = StartSpan.Depth;
 
 	//Similar logic to the one applied in the FindRegionConnection method
 	//Check the OpenHeightfield class for more details
@@ -134,12 +124,12 @@ void UContour::BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyN
 	while (LoopCount < UINT16_MAX)
 	{
 		//If the neighbor span does not belong to the same region
-		if (CurrentSpan->GetNeighborRegionFlag(Direction))
+		if (NeighborRegionFlags[CurrentSpan] & (1 << Direction))
 		{	
 			//Based on the span and field data retrieved the X, Y, Z position of the vertex
 			float PosX = BoundMin.X + CellSize * StartWidth;
 			float PosY = BoundMin.Y + (CellSize * StartDepth + CellSize);
-			float PosZ = BoundMin.Z + CellHeight * GetCornerHeightIndex(CurrentSpan, Direction);
+			float PosZ = BoundMin.Z + CellHeight * GetCornerHeightIndex(OpenHeightfield, CurrentSpan, Direction);
 
 			//Update the X and Y position based on the current direction
 			switch (Direction)
@@ -151,10 +141,10 @@ void UContour::BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyN
 
 			//If the neighbor exist, store its current region ID, otherwise default to 0
 			int RegionIDDirection = NULL_REGION;
-			UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(Direction);
-			if (NeighborSpan)
+			int NeighborSpan = OpenHeightfield->GetAxisNeighbor(CurrentSpan, Direction);
+			if (NeighborSpan != NULL_OPEN_SPAN)
 			{
-				RegionIDDirection = NeighborSpan->RegionID;
+				RegionIDDirection = RegionIDs[NeighborSpan];
 			}
 
 			//Check if the current contour is bordering a non-null region, if not then is an island contour
@@ -167,20 +157,20 @@ void UContour::BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyN
 			FContourVertexData Vertex;
 			Vertex.Coordinate = FVector(PosX, PosY, PosZ);
 			Vertex.ExternalRegionID = RegionIDDirection;
-			Vertex.InternalRegionID = CurrentSpan->RegionID;
+			Vertex.InternalRegionID = RegionIDs[CurrentSpan];
 
 			Vertex.RawIndex = IndexRaw;
 			VerticesRaw.Add(Vertex);
 
 			//Reset the flage of the neighbor processed and increase the direction in a clockwise direction
-			CurrentSpan->NeighborInDiffRegion[Direction] = false;
-			Direction = UOpenSpan::IncreaseNeighborDirection(Direction, 1);
+			NeighborRegionFlags[CurrentSpan] &= ~(1 << Direction);
+			Direction = FOpenSpan::IncreaseNeighborDirection(Direction, 1);
 			IndexRaw++;
 		}
 		else
 		{
 			//Set the span to the neighbor one considered
-			CurrentSpan = CurrentSpan->GetAxisNeighbor(Direction);
+			CurrentSpan = OpenHeightfield->GetAxisNeighbor(CurrentSpan, Direction);
 
 			//Move the wisth and depth to match the new span coordinates
 			switch (Direction)
@@ -192,11 +182,11 @@ void UContour::BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyN
 			}
 
 			//Rotate counterclockwise
-			Direction = UOpenSpan::IncreaseNeighborDirection(Direction, 3);
+			Direction = FOpenSpan::IncreaseNeighborDirection(Direction, 3);
 		}
 
 		//If the loop is complete and it goes back to the original span, exit
-		if (CurrentSpan == Span && Direction == StartDir)
+		if (CurrentSpan == SpanIndex && Direction == StartDir)
 		{
 			break;
 		}
@@ -394,39 +384,41 @@ void UContour::RemoveDuplicatesVertices(TArray<FContourVertexData>& VerticesSimp
 	}
 }
 
-int UContour::GetCornerHeightIndex(UOpenSpan* Span, const int NeighborDir)
+int UContour::GetCornerHeightIndex(const UOpenHeightfield* OpenHeightfield, const int SpanIndex, const int NeighborDir)
 {
+	const TArray<FOpenSpan>& Spans = OpenHeightfield->GetSpans();
+
 	//Set the max floor equal to the current span floor
-	int MaxFloor = Span->Min;
+	int MaxFloor = Spans[SpanIndex].Min;
 
-	UOpenSpan* DiagonalSpan = nullptr;
+	int DiagonalSpan = NULL_OPEN_SPAN;
 
 	//Increment the direction of the neghbor checking in clockwise order
-	int DirectionOffset = UOpenSpan::IncreaseNeighborDirection(NeighborDir, 1);
+	int DirectionOffset = FOpenSpan::IncreaseNeighborDirection(NeighborDir, 1);
 
 	//Get neighbor, if valid recheck the max floor value with the one of the neighbor span
-	UOpenSpan* AxisSpan = Span->GetAxisNeighbor(NeighborDir);
-	if (AxisSpan)
+	int AxisSpan = OpenHeightfield->GetAxisNeighbor(SpanIndex, NeighborDir);
+	if (AxisSpan != NULL_OPEN_SPAN)
 	{
-		MaxFloor = FMath::Max(MaxFloor, AxisSpan->Min);
-		DiagonalSpan = AxisSpan->GetAxisNeighbor(DirectionOffset);
+		MaxFloor = FMath::Max<int>(MaxFloor, Spans[AxisSpan].Min);
+		DiagonalSpan = OpenHeightfield->GetAxisNeighbor(AxisSpan, DirectionOffset);
 	}
 
 	//Get the following neighbor and, if valid, recheck again the max floor value
-	AxisSpan = Span->GetAxisNeighbor(DirectionOffset);
-	if (AxisSpan)
+	AxisSpan = OpenHeightfield->GetAxisNeighbor(SpanIndex, DirectionOffset);
+	if (AxisSpan != NULL_OPEN_SPAN)
 	{
-		MaxFloor = FMath::Max(MaxFloor, AxisSpan->Min);
-		if (!DiagonalSpan)
+		MaxFloor = FMath::Max<int>(MaxFloor, Spans[AxisSpan].Min);
+		if (DiagonalSpan == NULL_OPEN_SPAN)
 		{
-			DiagonalSpan = AxisSpan->GetAxisNeighbor(NeighborDir);
+			DiagonalSpan = OpenHeightfield->GetAxisNeighbor(AxisSpan, NeighborDir);
 		}
 	}
 
 	//Finally compared the max floor with the diagonal span one
-	if (DiagonalSpan)
+	if (DiagonalSpan != NULL_OPEN_SPAN)
 	{
-		MaxFloor = FMath::Max(MaxFloor, DiagonalSpan->Min);
+		MaxFloor = FMath::Max<int>(MaxFloor, Spans[DiagonalSpan].Min);
 	}
 
 	return MaxFloor;
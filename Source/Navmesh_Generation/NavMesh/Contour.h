@@ -7,7 +7,6 @@
 #include "Contour.generated.h"
 
 class UOpenHeightfield;
-class UOpenSpan;
 class ANavMeshController;
 
 USTRUCT()
@@ -49,7 +48,7 @@ public:
 	void FindNeighborRegionConnection(const UOpenHeightfield* OpenHeightfield, int& NumberOfContourDiscarded);
 
 	//Build the raw countour of a region, by iterating through all the border spans of it
-	void BuildRawContours(UOpenSpan* Span, const int StartDir, bool& OnlyNullRegionConnection, TArray<FContourVertexData>& RawVertices);
+	void BuildRawContours(const UOpenHeightfield* OpenHeightfield, const int SpanIndex, const int StartDir, bool& OnlyNullRegionConnection, TArray<FContourVertexData>& RawVertices);
 
 	//From the raw countour data, retrieved the simplified contour by removing the non-mandatory vertices
 	//The non-mandatory vertices are the ones that represent a switch in the region the contour is bordering
@@ -69,7 +68,7 @@ public:
 	void RemoveDuplicatesVertices(TArray<FContourVertexData>& VerticesSimplified);
 
 	//Get the highest grid cell value of the corner spans
-	int GetCornerHeightIndex(UOpenSpan* Span, const int NeighborDir);
+	int GetCornerHeightIndex(const UOpenHeightfield* OpenHeightfield, const int SpanIndex, const int NeighborDir);
 
 	//Draw the raw contour of the region passed in
 	void DrawRegionContour();
@@ -96,6 +95,10 @@ private:
 	//Vertices representing the simplified contour
 	TArray<FContourVertexData> SimplifiedVertices;
 
+	//Flags of the open spans, one bit for every axis neighbor belonging to a different region than the span one
+	//The bits are cleared while the raw contours are built, so every edge is processed once
+	TArray<uint8> NeighborRegionFlags;
+
 	//A pointer to the world has been added for debug purposes to use all the intermediate debug functions present inside the single methods
 	//UObjects by default don't have access to the world
 	UWorld* CurrentWorld;
@@ -3,14 +3,7 @@
 
 #include "HeightSpan.h"
 
-UHeightSpan::UHeightSpan(const int MinHeight, const int MaxHeight, const PolygonType& Type)
-	: Min(MinHeight),
-	  Max(MaxHeight),
-	  SpanAttribute(Type)
-{
-}
-
-void UHeightSpan::SetMaxHeight(const int NewHeight)
+void FHeightSpan::SetMaxHeight(const int NewHeight)
 {
 	if (NewHeight <= Min)
 	{
@@ -22,7 +15,7 @@ void UHeightSpan::SetMaxHeight(const int NewHeight)
 	}
 }
 
-void UHeightSpan::SetMinHeight(const int NewHeight)
+void FHeightSpan::SetMinHeight(const int NewHeight)
 {
 	if (NewHeight >= Max)
 	{
@@ -34,3 +27,249 @@ void UHeightSpan::SetMinHeight(const int NewHeight)
 	}
 }
 
+uint32 FHeightSpanPool::AllocateSpan(const int Min, const int Max, const uint8 Area, const uint32 NextSpan)
+{
+	uint32 SpanIndex = FreeSpan;
+
+	//Reuse the last released span if there is one, otherwise grow the pool
+	if (SpanIndex != NULL_SPAN)
+	{
+		FreeSpan = Spans[SpanIndex].NextSpan;
+		FreeSpanCount--;
+	}
+	else
+	{
+		SpanIndex = Spans.AddUninitialized();
+	}
+
+	FHeightSpan& NewSpan = Spans[SpanIndex];
+	NewSpan.Min = Min;
+	NewSpan.Max = Max;
+	NewSpan.Area = Area;
+	NewSpan.NextSpan = NextSpan;
+
+	return SpanIndex;
+}
+
+void FHeightSpanPool::ReleaseSpan(const uint32 SpanIndex)
+{
+	Spans[SpanIndex].NextSpan = FreeSpan;
+	FreeSpan = SpanIndex;
+	FreeSpanCount++;
+}
+
+void FHeightSpanPool::Empty()
+{
+	Spans.Empty();
+	FreeSpan = NULL_SPAN;
+	FreeSpanCount = 0;
+}
+
+void FHeightSpanColumns::Init(const int InOffsetWidth, const int InOffsetDepth, const int InWidth, const int InDepth)
+{
+	OffsetWidth = InOffsetWidth;
+	OffsetDepth = InOffsetDepth;
+	Width = FMath::Max(InWidth, 0);
+	Depth = FMath::Max(InDepth, 0);
+
+	Columns.Init(NULL_SPAN, Width * Depth);
+	Pool.Empty();
+}
+
+bool FHeightSpanColumns::AddSpan(const int WidthIndex, const int DepthIndex, int HeightIndexMin, int HeightIndexMax, const uint8 Area)
+{
+	//Check the boundaries of cells passed in and ignore them if they exceed the area covered by the columns
+	int LocalWidth = WidthIndex - OffsetWidth;
+	int LocalDepth = DepthIndex - OffsetDepth;
+
+	if (LocalWidth < 0 || LocalWidth >= Width || LocalDepth < 0 || LocalDepth >= Depth)
+	{
+		return false;
+	}
+
+	if (HeightIndexMin < 0 || HeightIndexMax < 0 || HeightIndexMin > HeightIndexMax)
+	{
+		return false;
+	}
+
+	//Make sure the height data fits inside the span
+	HeightIndexMin = FMath::Min(HeightIndexMin, SPAN_MAX_HEIGHT - 1);
+	HeightIndexMax = FMath::Min(HeightIndexMax, SPAN_MAX_HEIGHT);
+
+	//If the grid location contains no data, generate a new span and add it to the container
+	int GridIndex = LocalDepth * Width + LocalWidth;
+
+	uint32 CurrentIndex = Columns[GridIndex];
+	if (CurrentIndex == NULL_SPAN)
+	{
+		Columns[GridIndex] = Pool.AllocateSpan(HeightIndexMin, HeightIndexMax, Area, NULL_SPAN);
+		return true;
+	}
+
+	// If a span data already exists, search the spans in the column to see which one should contain this span
+	//or if a new span should be created
+	uint32 PreviousIndex = NULL_SPAN;
+	while (CurrentIndex != NULL_SPAN)
+	{
+		FHeightSpan& CurrentSpan = Pool[CurrentIndex];
+
+		//Check if the new span is below the current span
+		if (CurrentSpan.Min > HeightIndexMax + 1)
+		{
+			//If it is, create a new span and insert it below the current span
+			uint32 NewIndex = Pool.AllocateSpan(HeightIndexMin, HeightIndexMax, Area, CurrentIndex);
+
+			//If the new span is the first one in this column, insert it at the base
+			if (PreviousIndex == NULL_SPAN)
+			{
+				Columns[GridIndex] = NewIndex;
+			}
+
+			//If the new span is between 2 spans, link the previous span to the new one
+			else
+			{
+				Pool[PreviousIndex].NextSpan = NewIndex;
+			}
+
+			return true;
+		}
+
+		//Current span is below the new span
+		else if (CurrentSpan.Max < HeightIndexMin - 1)
+		{
+			//Current span is not adjacent to new span
+			if (CurrentSpan.NextSpan == NULL_SPAN)
+			{
+				//Locate the new span above the current one
+				//The allocation can move the pool storage, so the current span is accessed by index afterwards
+				uint32 NewIndex = Pool.AllocateSpan(HeightIndexMin, HeightIndexMax, Area, NULL_SPAN);
+				Pool[CurrentIndex].NextSpan = NewIndex;
+
+				return true;
+			}
+
+			PreviousIndex = CurrentIndex;
+			CurrentIndex = CurrentSpan.NextSpan;
+		}
+
+		//There's overlap or adjacency between new and current span, merge is needed
+		else
+		{
+			if (HeightIndexMin < CurrentSpan.Min)
+			{
+				//Base on the condition above, set the new height min of the current span
+				CurrentSpan.SetMinHeight(HeightIndexMin);
+			}
+
+			if (HeightIndexMax == CurrentSpan.Max)
+			{
+				//Base on the condition above, merge the span area
+				CurrentSpan.Area = Area;
+				return true;
+			}
+
+			if (CurrentSpan.Max > HeightIndexMax)
+			{
+				//Current span is higher than new one, no need to preform any action, current one takes priority
+				return true;
+			}
+
+			//If all the condition above are skipped, the new spans's maximum height is higher than the current span's maximum height
+			//Need to check where the merge ends
+			uint32 NextIndex = CurrentSpan.NextSpan;
+			while (true)
+			{		
+				if (NextIndex == NULL_SPAN || Pool[NextIndex].Min > HeightIndexMax + 1)
+				{
+					//If there are no spans above the current one or the height increase does not affect the next span
+					//the current span max and area can be directly replaced and set
+					//If current span at top of the column, this also removes any possible link it could have had
+					CurrentSpan.SetMaxHeight(HeightIndexMax);
+					CurrentSpan.Area = Area;
+					CurrentSpan.NextSpan = NextIndex;
+
+					return true;
+				}
+
+				FHeightSpan& NextSpan = Pool[NextIndex];
+
+				//The new height of the current span is overlapping with another span, merging needed
+				//If no gap between current and next span and no overlap as well
+				if (NextSpan.Min == HeightIndexMax + 1 || HeightIndexMax <= NextSpan.Max)
+				{
+					CurrentSpan.SetMaxHeight(NextSpan.Max);
+					CurrentSpan.NextSpan = NextSpan.NextSpan;
+					CurrentSpan.Area = NextSpan.Area;
+
+					//If the new span has the same height of the current ne, merge the area
+					if (HeightIndexMax == CurrentSpan.Max)
+					{
+						CurrentSpan.Area = Area;
+					}
+
+					//The next span is now part of the current one
+					Pool.ReleaseSpan(NextIndex);
+					return true;
+				}
+
+				//The current span overlaps the next one, go up in the column to see when the next will be fully included
+				//The fully included span is no longer needed and can be recycled
+				uint32 IncludedIndex = NextIndex;
+				NextIndex = NextSpan.NextSpan;
+				Pool.ReleaseSpan(IncludedIndex);
+			}
+		}
+	}
+
+	//Error in the span calculation
+	return false;
+}
+
+void FHeightSpanColumns::Merge(const FHeightSpanColumns& Other)
+{
+	MergeTransformed(Other, 0, 0, 0, 0);
+}
+
+void FHeightSpanColumns::MergeTransformed(const FHeightSpanColumns& Other, const int InOffsetWidth, const int InOffsetDepth, const int InOffsetHeight, const int QuarterTurns)
+{
+	const int Turns = QuarterTurns & 0x03;
+
+	for (int DepthIndex = 0; DepthIndex < Other.Depth; DepthIndex++)
+	{
+		for (int WidthIndex = 0; WidthIndex < Other.Width; WidthIndex++)
+		{
+			//Rotate the cell around the origin, every quarter turn maps the cell (X, Y) to (-Y - 1, X)
+			int CellWidth = Other.OffsetWidth + WidthIndex;
+			int CellDepth = Other.OffsetDepth + DepthIndex;
+
+			for (int It = 0; It < Turns; It++)
+			{
+				int RotatedWidth = -CellDepth - 1;
+				CellDepth = CellWidth;
+				CellWidth = RotatedWidth;
+			}
+
+			CellWidth += InOffsetWidth;
+			CellDepth += InOffsetDepth;
+
+			//Add the spans of the column from the bottom to the top
+			uint32 CurrentIndex = Other.Columns[DepthIndex * Other.Width + WidthIndex];
+
+			while (CurrentIndex != NULL_SPAN)
+			{
+				const FHeightSpan& Span = Other.Pool[CurrentIndex];
+				CurrentIndex = Span.NextSpan;
+
+				int SpanMax = Span.Max + InOffsetHeight;
+
+				//The span is completely below the grid
+				if (SpanMax < 0)
+				{
+					continue;
+				}
+
+				AddSpan(CellWidth, CellDepth, FMath::Max(Span.Min + InOffsetHeight, 0), SpanMax, Span.Area);
+			}
+		}
+	}
+}
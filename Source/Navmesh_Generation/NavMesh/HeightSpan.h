@@ -6,57 +6,120 @@
 #include "UObject/NoExportTypes.h"
 #include "HeightSpan.generated.h"
 
-UENUM()
-enum class PolygonType : uint8
-{
-	WALKABLE = 0	UMETA(DisplayName = "WALKABLE"),
-	UNWALKABLE		UMETA(DisplayName = "UNWALKABLE")
-};
+//Index used to mark the end of a span column or an empty column
+#define NULL_SPAN 0xFFFFFFFF
 
-UCLASS()
-class NAVMESH_GENERATION_API UHeightSpan : public UObject
-{
-	GENERATED_BODY()
-	
-public:	
-	// Sets default values for this actor's properties
-	UHeightSpan() {};
+//Number of bits used to store the min and max height of a span
+#define SPAN_HEIGHT_BITS 13
+
+//Highest value a span min/max can store
+#define SPAN_MAX_HEIGHT ((1 << SPAN_HEIGHT_BITS) - 1)
 
-	UHeightSpan(const int MinHeight, const int MaxHeight, const PolygonType& Type);
+//Number of bits used to store the area of a span
+#define SPAN_AREA_BITS 6
 
-	// Called every frame
-	virtual void Tick(float DeltaTime) {};
+//Area ID of the spans that can't be traversed
+#define NULL_AREA 0
+
+//Default area ID of the traversable spans, the IDs in between can be used to tag spans with custom areas
+#define WALKABLE_AREA ((1 << SPAN_AREA_BITS) - 1)
+
+/*Solid span data packed in 8 bytes, the width and depth of the span are implied by the heightfield column it is stored in
+  The bitfields have no default value, the spans are always initialized through FHeightSpanPool::AllocateSpan*/
+USTRUCT()
+struct FHeightSpan
+{
+	GENERATED_USTRUCT_BODY()
 
 	//Set the new max span height value, auto clamp the value to the span min + 1
 	void SetMaxHeight(const int NewHeight);
 
-	//Set the new max span height value, auto clamp the value to the span max - 1
+	//Set the new min span height value, auto clamp the value to the span max - 1
 	void SetMinHeight(const int NewHeight);
 
 	//Min height of the span
-	int Min = 0;
+	uint32 Min : SPAN_HEIGHT_BITS;
 
 	//Max height of the span
-	int Max = 0;
+	uint32 Max : SPAN_HEIGHT_BITS;
 
-	//Width of the span
-	int Width = 0;
+	//Area ID of the span, NULL_AREA if the span is not traversable
+	uint32 Area : SPAN_AREA_BITS;
 
-	//Depth of the span
-	int Depth = 0;
+	//Index inside the span pool of the next span in the column, NULL_SPAN if this is the top span
+	uint32 NextSpan;
+};
+
+/*Contiguous storage owning all the solid spans created during a build
+  The spans removed while merging are recycled through a free list and the whole pool is released in one go
+  Spans are referenced by index, so references to them must not be kept across an allocation*/
+class NAVMESH_GENERATION_API FHeightSpanPool
+{
+public:
+	//Return the index of a new span initialized with the values passed in, reusing a released span if available
+	uint32 AllocateSpan(const int Min, const int Max, const uint8 Area, const uint32 NextSpan);
+
+	//Add the span to the free list so that the next allocation can reuse it
+	void ReleaseSpan(const uint32 SpanIndex);
+
+	//Release all the spans at once
+	void Empty();
+
+	FHeightSpan& operator[](const uint32 SpanIndex) { return Spans[SpanIndex]; };
+	const FHeightSpan& operator[](const uint32 SpanIndex) const { return Spans[SpanIndex]; };
 
-	/*Next span in the column
-	  Flagged as uproperty as it is needed to have Unreal keep track of it, if not the pointer will be invalidated 
-	  as soon as the code exit the scope in which it has been assigned*/
-	UPROPERTY()
-	UHeightSpan* nextSpan;
+	//Number of spans currently in use
+	int Num() const { return Spans.Num() - FreeSpanCount; };
 
-	//Attribute of the span considered
-	PolygonType SpanAttribute;
+	//Number of spans allocated, including the released ones, every span index is lower than this value
+	int GetCapacity() const { return Spans.Num(); };
 
-protected:
-	// Called when the game starts or when spawned
-	virtual void BeginPlay() {};
+private:
+	TArray<FHeightSpan> Spans;
+
+	//Head of the list of released spans, linked through their NextSpan index
+	uint32 FreeSpan = NULL_SPAN;
+
+	int FreeSpanCount = 0;
+};
+
+/*Span columns covering a rectangular area of the heightfield grid, together with the pool storing their spans
+  Used both for the whole solid heightfield and for the spans generated by a single mesh, which can be voxelized on a separate thread
+  and merged later into the heightfield*/
+USTRUCT()
+struct FHeightSpanColumns
+{
+	GENERATED_USTRUCT_BODY()
+
+	//Allocate the empty columns of the area, the offset is the grid location of the first column inside the heightfield
+	void Init(const int InOffsetWidth, const int InOffsetDepth, const int InWidth, const int InDepth);
+
+	/*Add span data to the column at the grid location passed in, the new span is either merged into existing spans or a new span is created
+	  Return true if the data is successfully added, otherwise false*/
+	bool AddSpan(const int WidthIndex, const int DepthIndex, int HeightIndexMin, int HeightIndexMax, const uint8 Area);
+
+	//Add all the spans of the other columns to these ones, following the same merge rules of AddSpan
+	//The columns are processed in order, so the result only depends on the order in which the merges are performed
+	void Merge(const FHeightSpanColumns& Other);
+
+	/*Same as Merge, the other columns are rotated by 90 degrees around the grid origin for every quarter turn and then offset by the values passed in
+	  The spans that end up below the base of the grid are clamped to it*/
+	void MergeTransformed(const FHeightSpanColumns& Other, const int InOffsetWidth, const int InOffsetDepth, const int InOffsetHeight, const int QuarterTurns);
+
+	//Grid location of the first column inside the heightfield
+	int OffsetWidth = 0;
+
+	int OffsetDepth = 0;
+
+	//Number of columns along the width and depth of the area
+	int Width = 0;
+
+	int Depth = 0;
 
+	//Index of the base span of every column contained in the area, stored row by row (Width * Depth entries)
+	//Empty columns are set to NULL_SPAN
+	TArray<uint32> Columns;
 
+	//Storage of all the spans contained in the columns
+	FHeightSpanPool Pool;
 };
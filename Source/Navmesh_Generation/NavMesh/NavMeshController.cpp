@@ -108,38 +108,43 @@ void ANavMeshController::DisplayDebugElements()
 	DeleteDebugPlanes();
 	DeleteDebugText();
 
-	if (EnableHeightSpanDebug)
+	//Every nav bounds has its own generation objects
+	for (const FNavMeshBuildJob& Job : NavMeshGenerator->GetBuildJobs())
 	{
-		NavMeshGenerator->GetSolidHeightfield()->DrawDebugSpanData();
-	}
-
-	if (EnableOpenSpanDebug)
-	{
-		NavMeshGenerator->GetOpenHeightfield()->DrawDebugSpanData();
-	}
-
-	if (EnableDistanceFieldDebug)
-	{
-		NavMeshGenerator->GetOpenHeightfield()->DrawDistanceFieldDebugData(false, true);
-	}
-
-	if (EnableRegionsDebug)
-	{
-		NavMeshGenerator->GetOpenHeightfield()->DrawDebugRegions(false, true);
-	}
-
-	if (EnableContourDebug)
-	{
-		NavMeshGenerator->GetContour()->DrawRegionContour();
-	}
-
-	if (EnablePolyMeshDebug)
-	{
-		NavMeshGenerator->GetPolygonMesh()->DrawDebugPolyMeshPolys();
-	}
-
-	if (EnablePolyCentroidDebug)
-	{
-		NavMeshGenerator->GetPolygonMesh()->DrawPolygonCentroid();
+		if (EnableHeightSpanDebug)
+		{
+			Job.SolidHF->DrawDebugSpanData();
+		}
+
+		if (EnableOpenSpanDebug)
+		{
+			Job.OpenHF->DrawDebugSpanData();
+		}
+
+		//Only the watershed partitioning builds the whole distance field
+		if (EnableDistanceFieldDebug && Partitioning == RegionPartitioning::WATERSHED)
+		{
+			Job.OpenHF->DrawDistanceFieldDebugData(false, true);
+		}
+
+		if (EnableRegionsDebug)
+		{
+			Job.OpenHF->DrawDebugRegions(false, true);
+		}
+
+		if (EnableContourDebug)
+		{
+			Job.Contour->DrawRegionContour();
+		}
+
+		if (EnablePolyMeshDebug)
+		{
+			Job.PolygonMesh->DrawDebugPolyMeshPolys();
+		}
+
+		if (EnablePolyCentroidDebug)
+		{
+			Job.PolygonMesh->DrawPolygonCentroid();
+		}
 	}
 }
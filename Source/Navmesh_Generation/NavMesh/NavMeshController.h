@@ -13,6 +13,23 @@ class UContour;
 class UPolygonMesh;
 class FNavMeshGenerator;
 
+//Geometry of the static meshes used to generate the solid heightfield
+UENUM()
+enum class VoxelizationSource : uint8
+{
+	RENDER_MESH = 0		UMETA(DisplayName = "RENDER_MESH"),
+	SIMPLE_COLLISION	UMETA(DisplayName = "SIMPLE_COLLISION")
+};
+
+//Algorithm used to divide the open heightfield into regions
+UENUM()
+enum class RegionPartitioning : uint8
+{
+	WATERSHED = 0	UMETA(DisplayName = "WATERSHED"),
+	MONOTONE		UMETA(DisplayName = "MONOTONE"),
+	LAYERS			UMETA(DisplayName = "LAYERS")
+};
+
 UCLASS(config = Engine, defaultconfig, hidecategories = (Input, Rendering, Collision, Physics, Tags, "Utilities|Transformation", Actor, Layers, Replication), notplaceable)
 class NAVMESH_GENERATION_API ANavMeshController : public AActor
 {
@@ -64,6 +81,11 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters", meta = (DisplayName = "EnableDirtyAreasRebuild"))
 	bool EnableDirtyAreasRebuild = true;
 
+	//Use the vectorized (SIMD) version of the generation stages that provide one
+	//Disable to compare against the scalar version using the "stat NavMeshGeneration" console command
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters", meta = (DisplayName = "EnableVectorization"))
+	bool EnableVectorization = true;
+
 	//Size of the single cells (voxels) in which the heightfiels is subdivided, the cells are squared
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "CellSize"))
 	float CellSize = 30.f;
@@ -72,6 +94,24 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "CellHeight"))
 	float CellHeight = 30.f;
 
+	//Geometry voxelized to generate the solid heightfield: the triangles of the render mesh (at the GeometryLOD specified)
+	//or the simple collision of the mesh (boxes, spheres, capsules and convexes), the render mesh is used for meshes without simple collision
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "GeometrySource"))
+	VoxelizationSource GeometrySource = VoxelizationSource::RENDER_MESH;
+
+	//LOD of the render mesh used when voxelizing the render geometry, clamped to the LODs available for every mesh
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "GeometryLOD", ClampMin = "0"))
+	int GeometryLOD = 0;
+
+	//Build the solid heightfield one chunk at a time, the solid spans of a chunk are released once its open spans are created
+	//Bounds the memory used by large nav bounds, at the cost of voxelizing again the geometries overlapping multiple chunks (the voxel cache is not used)
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "EnableChunkedVoxelization"))
+	bool EnableChunkedVoxelization = false;
+
+	//Number of cells along the width and depth of every chunk, excluding the border shared with the adjacent chunks
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "ChunkSize", ClampMin = "8"))
+	int ChunkSize = 128;
+
 	//Represent the maximum slope angle (in degree) that is considered traversable
 	//Cells that pass the value specified are flagged as UNWALKABLE
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "MaxTraversableAngle"))
@@ -90,7 +130,16 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|SolidHeightfield", meta = (DisplayName = "EnableHeightSpanDebug"))
 	bool EnableHeightSpanDebug = false;
 
+	/*Algorithm used to divide the traversable area into regions
+	  WATERSHED builds a distance field and floods it, it produces the best shaped regions and is the slowest
+	  MONOTONE sweeps the rows without any distance field, it is the fastest but produces long and thin regions
+	  LAYERS merges every monotone region into its smallest neighbor touching it along a single edge and not overlapping it, between the other two for both speed and quality
+	  TraversableAreaBorderSize is applied by all of them, SmoothingThreshold only affects the WATERSHED partitioning*/
+	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|OpenHeightfield", meta = (DisplayName = "Partitioning"))
+	RegionPartitioning Partitioning = RegionPartitioning::WATERSHED;
+
 	//The amount of smoothing to be performed when generating the distance field
+	//The spans closer to the border than this value (in cells) keep their distance, the other ones are blurred
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|OpenHeightfield", meta = (DisplayName = "SmoothingThreshold"))
 	int SmoothingThreshold = 2;
 
@@ -118,7 +167,7 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|OpenHeightfield", meta = (DisplayName = "EnableOpenSpanDebug"))
 	bool EnableOpenSpanDebug = false;
 
-	//Enable the debug visualization of the distance field
+	//Enable the debug visualization of the distance field, only built by the WATERSHED partitioning
 	UPROPERTY(EditAnywhere, Category = "NavmeshParameters|OpenHeightfield", meta = (DisplayName = "EnableDistanceFieldDebug"))
 	bool EnableDistanceFieldDebug = false;
 
@@ -14,11 +14,16 @@
 #include "../Utility/UtilityGeneral.h"
 #include "../Utility/UtilityDebug.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
 
 bool FNavMeshGenerator::RebuildAll()
 {
 	if (NavigationMesh->GetGenerator())
 	{
+		//The nav bounds volumes could have been added or removed since the last build
+		SetNavBounds();
+
 		//This need to be called in case the controller is accidentally deleted
 		NavigationMesh->CreateNavmeshController();
 		NavigationMesh->GetNavmeshController()->UpdateEditorPosition();
@@ -39,6 +44,7 @@ void FNavMeshGenerator::RebuildDirtyAreas(const TArray<FNavigationDirtyArea>& Di
 	//Naive implemetation as all the navmesh is rebuilt when a geometry is moved in the level
 	if (NavigationMesh->GetGenerator() && NavigationMesh->GetNavmeshController()->EnableDirtyAreasRebuild)
 	{
+		SetNavBounds();
 		NavigationMesh->CreateNavmeshController();
 		NavigationMesh->GetNavmeshController()->UpdateEditorPosition();
 
@@ -51,9 +57,7 @@ void FNavMeshGenerator::RebuildDirtyAreas(const TArray<FNavigationDirtyArea>& Di
 
 void FNavMeshGenerator::GatherValidOverlappingGeometries()
 {
-	Geometries.Empty();
-
-	TArray<AActor*> ValidGeometries;
+	BuildJobs.Empty();
 
 	//Query parameters for filtering the overlapping actors, ObjectTypeQuery1 = WorldStatic
 	TArray< TEnumAsByte<EObjectTypeQuery> > ObjectTypes;
@@ -61,133 +65,585 @@ void FNavMeshGenerator::GatherValidOverlappingGeometries()
 	
 	TArray<AActor*> ActorsToIgnore;
 
-	//Check which actors are overlapping with the box based on the parameters specified
-	UKismetSystemLibrary::BoxOverlapActors(NavigationMesh->GetWorld(), NavBounds.GetCenter(), NavBounds.GetExtent(), ObjectTypes, nullptr, ActorsToIgnore, ValidGeometries);
-
-	for (AActor*& actor : ValidGeometries)
+	for (const FBox& Bounds : NavBounds)
 	{
-		UActorComponent* ActorCmp = actor->GetComponentByClass(UStaticMeshComponent::StaticClass());
+		FNavMeshBuildJob Job;
+		Job.NavBounds = Bounds;
+
+		TArray<AActor*> ValidGeometries;
 
-		//Check if the overlapping actors have a static mesh component
-		if (ActorCmp)
+		//Check which actors are overlapping with the box based on the parameters specified
+		UKismetSystemLibrary::BoxOverlapActors(NavigationMesh->GetWorld(), Bounds.GetCenter(), Bounds.GetExtent(), ObjectTypes, nullptr, ActorsToIgnore, ValidGeometries);
+
+		TArray<UStaticMeshComponent*> MeshComponents;
+
+		for (AActor*& actor : ValidGeometries)
 		{
-			//Check if the actor is flagged as been able to affect the navigation
-			if (ActorCmp->CanEverAffectNavigation())
+			//Check all the static mesh components of the overlapping actors
+			actor->GetComponents<UStaticMeshComponent>(MeshComponents);
+
+			for (UStaticMeshComponent* Mesh : MeshComponents)
 			{
-				//Check if the actor collision has been set to block pawns
-				UStaticMeshComponent* Mesh = CastChecked<UStaticMeshComponent>(ActorCmp);
+				//Check if the component is flagged as been able to affect the navigation
+				if (!Mesh->CanEverAffectNavigation() || !Mesh->GetStaticMesh())
+				{
+					continue;
+				}
 
-				if (Mesh->GetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn) == ECollisionResponse::ECR_Block)
+				//Check if the component collision has been set to block pawns
+				if (Mesh->GetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn) != ECollisionResponse::ECR_Block)
+				{
+					continue;
+				}
+
+				//Instanced components (HISM included) are added per instance, the other ones are added to the array directly
+				if (UInstancedStaticMeshComponent* InstancedMesh = Cast<UInstancedStaticMeshComponent>(Mesh))
+				{
+					GatherMeshInstances(InstancedMesh, Job);
+				}
+				else
 				{
-					//Add the mesh to the array
-					Geometries.Add(Mesh);
+					Job.Geometries.Add(Mesh);
 				}
 			}
 		}
+
+		//The bounds without any valid geometry don't generate anything
+		if (Job.Geometries.Num() == 0 && Job.Instances.Num() == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("No valid geometries detected inside the nav bound, navmesh data generation skipped for it"));
+			continue;
+		}
+
+		BuildJobs.Add(MoveTemp(Job));
+	}
+}
+
+void FNavMeshGenerator::GatherMeshInstances(const UInstancedStaticMeshComponent* Mesh, FNavMeshBuildJob& Job)
+{
+	const FBox MeshBounds = Mesh->GetStaticMesh()->GetBoundingBox();
+
+	for (int InstanceIndex = 0; InstanceIndex < Mesh->GetInstanceCount(); InstanceIndex++)
+	{
+		FNavMeshInstance Instance;
+		Instance.Mesh = Mesh;
+		Mesh->GetInstanceTransform(InstanceIndex, Instance.Transform, true);
+		Instance.Bounds = MeshBounds.TransformBy(Instance.Transform);
+
+		//Skip the instances outside of the nav bounds
+		if (Instance.Bounds.Intersect(Job.NavBounds))
+		{
+			Job.Instances.Add(Instance);
+		}
 	}
 }
 
 void FNavMeshGenerator::GenerateNavmesh()
 {
-	if (Geometries.Num() == 0)
+	if (BuildJobs.Num() == 0)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No valid geometries detected inside the nav bound, navmesh data generation aborted"));
+		UE_LOG(LogTemp, Warning, TEXT("No valid geometries detected inside the nav bounds, navmesh data generation aborted"));
 		return;
 	}
 
-	InitializeNavmeshObjects();
+	const ANavMeshController* NavController = NavigationMesh->GetNavmeshController();
 
-	SolidHF->InitializeParameters(NavigationMesh->GetNavmeshController());
-	
-	//Calculate the extension of the nav bound and pass the data found to the solidheightfield to determine the area covered by it
-	FVector NavCenter = NavBounds.GetCenter();
-	FVector BoxBoundCoord = NavBounds.GetExtent();
-	float MaxCoord = FMath::Max(BoxBoundCoord.X, BoxBoundCoord.Y);
-	FVector MaxBoxBoundsCoord(MaxCoord, MaxCoord, BoxBoundCoord.Z);
-	
-	SolidHF->DefineFieldsBounds(NavCenter, MaxBoxBoundsCoord);
+	//The spans of the chunks are only valid for the grid of their chunk, keeping them would defeat the purpose of the chunked build
+	if (NavController->EnableChunkedVoxelization)
+	{
+		VoxelCache.Empty();
+	}
 
-	for (UStaticMeshComponent* Mesh : Geometries)
+	//Voxel data used by all the jobs of this build
+	FNavMeshBuildCache UsedCache;
+
+	//The geometries are read from the components and the spans are stored into UObjects, so the jobs are processed one at a time up to the open heightfield
+	//The voxelization of every job is performed in parallel anyway
+	for (FNavMeshBuildJob& Job : BuildJobs)
 	{
-		CreateSolidHeightfield(Mesh);
+		InitializeNavmeshObjects(Job);
+
+		Job.SolidHF->InitializeParameters(NavController);
+
+		//Calculate the extension of the nav bound and pass the data found to the solidheightfield to determine the area covered by it
+		//The grid follows the bounds on both axis, so long and narrow bounds don't allocate a square field
+		FVector NavCenter = Job.NavBounds.GetCenter();
+		FVector NavExtent = Job.NavBounds.GetExtent();
+
+		if (NavController->EnableChunkedVoxelization)
+		{
+			CreateChunkedOpenHeightfield(Job, UsedCache, NavCenter, NavExtent);
+		}
+		else
+		{
+			Job.SolidHF->DefineFieldsBounds(NavCenter, NavExtent);
+
+			CreateSolidHeightfield(Job, UsedCache);
+			FilterSolidHeightfield(Job);
+			CreateOpenHeightfield(Job);
+		}
 	}
 
-	CreateOpenHeightfield();
-	CreateContour();
-	CreatePolygonMesh();
+	//Only keep the voxel data used in this build
+	VoxelCache = MoveTemp(UsedCache.Spans);
+	TemplateCache = MoveTemp(UsedCache.Templates);
+
+	//Every job only accesses its own objects, so the stages that don't create any UObject run in parallel for all the jobs
+	ParallelFor(BuildJobs.Num(), [&](int32 JobIndex)
+	{
+		FNavMeshBuildJob& Job = BuildJobs[JobIndex];
+
+		GenerateOpenHeightfieldRegions(Job);
+		FilterOpenHeightfieldRegions(Job);
+		CreateContour(Job);
+		CreatePolygonMesh(Job);
+	});
 
 	SendDataToNavmesh();
 }
 
 //TODO: Need to clean them before creating the new ones
-void FNavMeshGenerator::InitializeNavmeshObjects()
+void FNavMeshGenerator::InitializeNavmeshObjects(FNavMeshBuildJob& Job)
 {
 	//The objects are reinitialized every single time the navmesh is updated in editor for an easier cleanup of the intermediate data
-	SolidHF = NewObject<USolidHeightfield>(USolidHeightfield::StaticClass());
-	OpenHF = NewObject<UOpenHeightfield>(UOpenHeightfield::StaticClass());
-	Contour = NewObject<UContour>(UContour::StaticClass());
-	PolygonMesh = NewObject<UPolygonMesh>(UPolygonMesh::StaticClass());
-	DetailedMesh = NewObject<UDetailedMesh>(UDetailedMesh::StaticClass());
+	Job.SolidHF = NewObject<USolidHeightfield>(USolidHeightfield::StaticClass());
+	Job.OpenHF = NewObject<UOpenHeightfield>(UOpenHeightfield::StaticClass());
+	Job.Contour = NewObject<UContour>(UContour::StaticClass());
+	Job.PolygonMesh = NewObject<UPolygonMesh>(UPolygonMesh::StaticClass());
+	Job.DetailedMesh = NewObject<UDetailedMesh>(UDetailedMesh::StaticClass());
 }
 
-void FNavMeshGenerator::CreateSolidHeightfield(const UStaticMeshComponent* Mesh)
+void FNavMeshGenerator::CreateChunkedOpenHeightfield(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const FVector AreaCenter, const FVector AreaExtent)
 {
-	TArray<FVector> Vertices;
-	TArray<int> Indices;
+	const ANavMeshController* NavController = NavigationMesh->GetNavmeshController();
+	USolidHeightfield* SolidHF = Job.SolidHF;
 
-	UUtilityGeneral::GetAllMeshVertices(Mesh, Vertices);
-	UUtilityGeneral::GetMeshIndices(Mesh, Indices);
-	
-	FString TextToDisplay = Mesh->GetOwner()->GetName();
-	FString AdditionalText = " has no geometry data to generate the solid heightfield";
-	TextToDisplay += AdditionalText;
+	//Define the grid of the whole field without allocating its columns, the open heightfield covers all of it
+	SolidHF->DefineFieldsBounds(AreaCenter, AreaExtent, false);
+	Job.OpenHF->InitializeParameters(SolidHF, NavController);
+
+	const FVoxelGrid FieldGrid = SolidHF->GetFieldGrid();
+	const int ChunkSize = NavController->ChunkSize;
 
-	if (Vertices.Num() == 0 || Indices.Num() == 0)
+	for (int ChunkDepth = 0; ChunkDepth < FieldGrid.Depth; ChunkDepth += ChunkSize)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("%s"), *TextToDisplay);
-		return;
+		for (int ChunkWidth = 0; ChunkWidth < FieldGrid.Width; ChunkWidth += ChunkSize)
+		{
+			//Cells of the field assigned to the chunk, the open spans are only created for them
+			const FIntRect ChunkArea(ChunkWidth, ChunkDepth, FMath::Min(ChunkWidth + ChunkSize, FieldGrid.Width), FMath::Min(ChunkDepth + ChunkSize, FieldGrid.Depth));
+
+			//The solid heightfield also covers the border around the chunk, clamped to the field so that the field edges behave as in a full build
+			const FIntRect SolidArea(
+				FMath::Max(ChunkArea.Min.X - CHUNK_BORDER_SIZE, 0), FMath::Max(ChunkArea.Min.Y - CHUNK_BORDER_SIZE, 0),
+				FMath::Min(ChunkArea.Max.X + CHUNK_BORDER_SIZE, FieldGrid.Width), FMath::Min(ChunkArea.Max.Y + CHUNK_BORDER_SIZE, FieldGrid.Depth));
+
+			SolidHF->DefineChunkBounds(FieldGrid, SolidArea);
+
+			//The templates are placed in the grid when merged, so they are shared by all the chunks
+			CreateSolidHeightfield(Job, UsedCache, true);
+			FilterSolidHeightfield(Job);
+			Job.OpenHF->FindOpenSpanData(SolidHF, ChunkArea);
+		}
+	}
+
+	//Release the spans of the last chunk and restore the bounds of the whole field
+	SolidHF->DefineFieldsBounds(AreaCenter, AreaExtent, false);
+
+	//The columns have been added chunk by chunk, process them in the same order of a full build
+	Job.OpenHF->SortSpans();
+}
+
+void FNavMeshGenerator::CreateSolidHeightfield(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const bool IsChunk)
+{
+	USolidHeightfield* SolidHF = Job.SolidHF;
+	TArray<const UStaticMeshComponent*> FieldGeometries;
+
+	if (IsChunk)
+	{
+		//Only the meshes touching the chunk are voxelized
+		const FBox FieldBounds(SolidHF->GetBoundMin(), SolidHF->GetBoundMax());
+
+		for (const UStaticMeshComponent* Mesh : Job.Geometries)
+		{
+			if (Mesh->Bounds.GetBox().Intersect(FieldBounds))
+			{
+				FieldGeometries.Add(Mesh);
+			}
+		}
+	}
+	else
+	{
+		FieldGeometries.Append(Job.Geometries);
+	}
+
+	int MeshCount = FieldGeometries.Num();
+
+	TArray<FVoxelCacheKey> MeshesKeys;
+	MeshesKeys.SetNum(MeshCount);
+
+	//Spans of every mesh, either taken from the cache or generated during this build
+	TArray<FHeightSpanColumns*> MeshesSpans;
+	MeshesSpans.Init(nullptr, MeshCount);
+
+	//Meshes that need to be voxelized as they are not present inside the cache
+	TArray<int> MeshesToVoxelize;
+
+	for (int MeshIndex = 0; MeshIndex < MeshCount; MeshIndex++)
+	{
+		if (IsChunk)
+		{
+			MeshesToVoxelize.Add(MeshIndex);
+			continue;
+		}
+
+		//The spans can have already been used by another job with the same grid, or be found in the cache of the last build
+		MeshesKeys[MeshIndex] = GetVoxelCacheKey(FieldGeometries[MeshIndex], SolidHF);
+		MeshesSpans[MeshIndex] = UsedCache.Spans.Find(MeshesKeys[MeshIndex]);
+
+		if (!MeshesSpans[MeshIndex])
+		{
+			MeshesSpans[MeshIndex] = VoxelCache.Find(MeshesKeys[MeshIndex]);
+		}
+
+		if (!MeshesSpans[MeshIndex])
+		{
+			MeshesToVoxelize.Add(MeshIndex);
+		}
+	}
+
+	int VoxelizeCount = MeshesToVoxelize.Num();
+
+	TArray<FVoxelGeometry> MeshesGeometries;
+	MeshesGeometries.SetNum(VoxelizeCount);
+
+	//The geometry data is retrieved on the game thread, as the mesh components and their render data can't be safely accessed by the workers
+	for (int It = 0; It < VoxelizeCount; It++)
+	{
+		const UStaticMeshComponent* Mesh = FieldGeometries[MeshesToVoxelize[It]];
+		GatherMeshGeometry(Mesh, Mesh->GetComponentTransform(), MeshesGeometries[It]);
+
+		if (MeshesGeometries[It].IsEmpty())
+		{
+			FString TextToDisplay = Mesh->GetOwner()->GetName();
+			FString AdditionalText = " has no geometry data to generate the solid heightfield";
+			TextToDisplay += AdditionalText;
+
+			UE_LOG(LogTemp, Warning, TEXT("%s"), *TextToDisplay);
+		}
 	}
 
-	SolidHF->VoxelizeTriangles(Vertices, Indices);
-	SolidHF->MarkLowHeightSpan();
-	SolidHF->MarkLedgeSpan();
+	//Every mesh is voxelized into its own span columns, so the meshes can be processed in parallel without sharing any data
+	TArray<FHeightSpanColumns> VoxelizedSpans;
+	VoxelizedSpans.SetNum(VoxelizeCount);
+
+	const USolidHeightfield* SolidField = SolidHF;
+	const FVoxelGrid FieldGrid = SolidHF->GetFieldGrid();
+	ParallelFor(VoxelizeCount, [&](int32 It)
+	{
+		SolidField->VoxelizeGeometry(MeshesGeometries[It], FieldGrid, VoxelizedSpans[It]);
+	});
+
+	for (int It = 0; It < VoxelizeCount; It++)
+	{
+		MeshesSpans[MeshesToVoxelize[It]] = &VoxelizedSpans[It];
+	}
+
+	//The spans are merged following the order of the meshes, so the result does not depend on the thread scheduling
+	for (int MeshIndex = 0; MeshIndex < MeshCount; MeshIndex++)
+	{
+		SolidHF->MergeSpans(*MeshesSpans[MeshIndex]);
+	}
+
+	if (!IsChunk)
+	{
+		//Keep the spans of the meshes used in this build, the data is moved as the old cache is discarded anyway
+		//The spans already in the map are skipped, so the pointers to them are not used after the map is modified
+		for (int MeshIndex = 0; MeshIndex < MeshCount; MeshIndex++)
+		{
+			if (!UsedCache.Spans.Contains(MeshesKeys[MeshIndex]))
+			{
+				UsedCache.Spans.Add(MeshesKeys[MeshIndex], MoveTemp(*MeshesSpans[MeshIndex]));
+			}
+		}
+	}
+
+	CreateInstancesSpans(Job, UsedCache, IsChunk);
 }
 
-void FNavMeshGenerator::CreateOpenHeightfield()
+FVoxelCacheKey FNavMeshGenerator::GetVoxelCacheKey(const UStaticMeshComponent* Mesh, const USolidHeightfield* SolidField) const
 {
-	OpenHF->InitializeParameters(SolidHF, NavigationMesh->GetNavmeshController());
-	OpenHF->FindOpenSpanData(SolidHF);
+	const ANavMeshController* NavController = NavigationMesh->GetNavmeshController();
+
+	FVoxelCacheKey Key;
+	Key.StaticMesh = Mesh->GetStaticMesh();
+	Key.RenderData = Key.StaticMesh ? Key.StaticMesh->GetRenderData() : nullptr;
+
+	//Same transform used to convert the vertices in world space
+	Key.Transform = Mesh->GetComponentTransform();
+	Key.CellSize = NavController->CellSize;
+	Key.CellHeight = NavController->CellHeight;
+	Key.MaxTraversableAngle = NavController->MaxTraversableAngle;
+	Key.GeometrySource = uint8(NavController->GeometrySource);
+	Key.GeometryLOD = NavController->GeometryLOD;
+	Key.FieldBoundMin = SolidField->GetBoundMin();
+	Key.FieldWidth = SolidField->GetWidth();
+	Key.FieldDepth = SolidField->GetDepth();
+
+	return Key;
+}
+
+void FNavMeshGenerator::GatherMeshGeometry(const UStaticMeshComponent* Mesh, const FTransform& Transform, FVoxelGeometry& OutGeometry) const
+{
+	const ANavMeshController* NavController = NavigationMesh->GetNavmeshController();
+	const UStaticMesh* StaticMesh = Mesh->GetStaticMesh();
+
+	if (NavController->GeometrySource == VoxelizationSource::SIMPLE_COLLISION)
+	{
+		UUtilityGeneral::GetStaticMeshSimpleCollision(StaticMesh, Transform, OutGeometry.Vertices, OutGeometry.Indices, OutGeometry.Boxes);
+
+		if (!OutGeometry.IsEmpty())
+		{
+			return;
+		}
+	}
+
+	//Only the unique vertices are retrieved (and transformed), the triangles are read through the index buffer
+	UUtilityGeneral::GetStaticMeshLocalVertices(StaticMesh, OutGeometry.Vertices, NavController->GeometryLOD);
+	UUtilityGeneral::GetStaticMeshIndices(StaticMesh, OutGeometry.Indices, NavController->GeometryLOD);
+
+	for (FVector& Vertex : OutGeometry.Vertices)
+	{
+		Vertex = Transform.TransformPosition(Vertex);
+	}
+}
+
+void FNavMeshGenerator::CreateInstancesSpans(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const bool IsChunk)
+{
+	USolidHeightfield* SolidHF = Job.SolidHF;
+	TMap<FVoxelTemplateKey, FVoxelTemplate>& UsedTemplates = UsedCache.Templates;
+
+	TArray<const FNavMeshInstance*> FieldInstances;
+	const FBox FieldBounds(SolidHF->GetBoundMin(), SolidHF->GetBoundMax());
+
+	for (const FNavMeshInstance& Instance : Job.Instances)
+	{
+		//Only the instances touching the chunk are merged
+		if (!IsChunk || Instance.Bounds.Intersect(FieldBounds))
+		{
+			FieldInstances.Add(&Instance);
+		}
+	}
+
+	int InstanceCount = FieldInstances.Num();
+
+	TArray<FVoxelTemplateKey> InstancesKeys;
+	TArray<FIntVector> InstancesCells;
+	TArray<int> InstancesTurns;
+	InstancesKeys.SetNum(InstanceCount);
+	InstancesCells.SetNum(InstanceCount);
+	InstancesTurns.SetNum(InstanceCount);
+
+	//Templates that need to be voxelized, together with a component using them to retrieve the geometry
+	TArray<FVoxelTemplateKey> TemplatesToVoxelize;
+	TArray<const UInstancedStaticMeshComponent*> TemplatesMeshes;
+
+	for (int InstanceIndex = 0; InstanceIndex < InstanceCount; InstanceIndex++)
+	{
+		FVoxelTemplateKey& Key = InstancesKeys[InstanceIndex];
+		GetInstancePlacement(*FieldInstances[InstanceIndex], SolidHF, Key, InstancesCells[InstanceIndex], InstancesTurns[InstanceIndex]);
+
+		if (UsedTemplates.Contains(Key))
+		{
+			continue;
+		}
+
+		//The templates already voxelized during the last build are moved from the old cache
+		if (FVoxelTemplate* CachedTemplate = TemplateCache.Find(Key))
+		{
+			UsedTemplates.Add(Key, MoveTemp(*CachedTemplate));
+		}
+		else
+		{
+			UsedTemplates.Add(Key);
+			TemplatesToVoxelize.Add(Key);
+			TemplatesMeshes.Add(FieldInstances[InstanceIndex]->Mesh);
+		}
+	}
+
+	int TemplateCount = TemplatesToVoxelize.Num();
+
+	TArray<FVoxelGeometry> TemplatesGeometries;
+	TArray<FVoxelTemplate*> Templates;
+	TemplatesGeometries.SetNum(TemplateCount);
+	Templates.SetNum(TemplateCount);
+
+	//The geometry data is retrieved on the game thread
+	for (int It = 0; It < TemplateCount; It++)
+	{
+		//Apply the rotation and scale of the template and move it to its location inside the origin cell
+		const FVoxelTemplateKey& Key = TemplatesToVoxelize[It];
+		const FRotator Rotation = FRotator(Key.Rotation.X, Key.Rotation.Y, Key.Rotation.Z) * (1.f / TEMPLATE_ROTATION_STEPS);
+		const FVector Offset = FVector(Key.Fraction) / TEMPLATE_FRACTION_STEPS * FVector(Key.CellSize, Key.CellSize, Key.CellHeight);
+
+		GatherMeshGeometry(TemplatesMeshes[It], FTransform(Rotation, Offset, Key.Scale), TemplatesGeometries[It]);
+
+		//The map is not modified anymore, so the pointers to its values stay valid
+		Templates[It] = UsedTemplates.Find(TemplatesToVoxelize[It]);
+	}
+
+	const USolidHeightfield* SolidField = SolidHF;
+	ParallelFor(TemplateCount, [&](int32 It)
+	{
+		SolidField->VoxelizeTemplate(TemplatesGeometries[It], *Templates[It]);
+	});
+
+	//The templates are replayed following the order of the instances, so the result does not depend on the thread scheduling
+	for (int InstanceIndex = 0; InstanceIndex < InstanceCount; InstanceIndex++)
+	{
+		SolidHF->MergeTemplate(UsedTemplates.FindChecked(InstancesKeys[InstanceIndex]), InstancesCells[InstanceIndex], InstancesTurns[InstanceIndex]);
+	}
+}
+
+void FNavMeshGenerator::GetInstancePlacement(const FNavMeshInstance& Instance, const USolidHeightfield* SolidField, FVoxelTemplateKey& OutKey, FIntVector& OutCell, int& OutQuarterTurns) const
+{
+	const ANavMeshController* NavController = NavigationMesh->GetNavmeshController();
+	const FVector CellExtent(NavController->CellSize, NavController->CellSize, NavController->CellHeight);
+
+	//Split the location of the instance in the grid into the cell containing it and the offset inside the cell
+	const FVector GridLocation = (Instance.Transform.GetLocation() - SolidField->GetBoundMin()) / CellExtent;
+	OutCell = FIntVector(FMath::FloorToInt(GridLocation.X), FMath::FloorToInt(GridLocation.Y), FMath::FloorToInt(GridLocation.Z));
+
+	FIntVector Fraction;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		Fraction[Axis] = FMath::RoundToInt((GridLocation[Axis] - OutCell[Axis]) * TEMPLATE_FRACTION_STEPS);
+
+		//The offset has been rounded up to the next cell
+		if (Fraction[Axis] == TEMPLATE_FRACTION_STEPS)
+		{
+			Fraction[Axis] = 0;
+			OutCell[Axis]++;
+		}
+	}
+
+	//When the origin lies on a grid corner, rotations of 90 degrees around the up axis map the cells onto other cells
+	//so the instances rotated by quarter turns can share the same template
+	FRotator Rotation = Instance.Transform.Rotator();
+	OutQuarterTurns = 0;
+
+	if (Fraction.X == 0 && Fraction.Y == 0)
+	{
+		OutQuarterTurns = FMath::RoundToInt(Rotation.Yaw / 90.f);
+		Rotation.Yaw -= OutQuarterTurns * 90.f;
+	}
+
+	OutKey.StaticMesh = Instance.Mesh->GetStaticMesh();
+	OutKey.RenderData = OutKey.StaticMesh->GetRenderData();
+	OutKey.Rotation = FIntVector(FMath::RoundToInt(Rotation.Pitch * TEMPLATE_ROTATION_STEPS), FMath::RoundToInt(Rotation.Yaw * TEMPLATE_ROTATION_STEPS), FMath::RoundToInt(Rotation.Roll * TEMPLATE_ROTATION_STEPS));
+	OutKey.Scale = Instance.Transform.GetScale3D();
+	OutKey.Fraction = Fraction;
+	OutKey.CellSize = NavController->CellSize;
+	OutKey.CellHeight = NavController->CellHeight;
+	OutKey.MaxTraversableAngle = NavController->MaxTraversableAngle;
+	OutKey.GeometrySource = uint8(NavController->GeometrySource);
+	OutKey.GeometryLOD = NavController->GeometryLOD;
+}
+
+void FNavMeshGenerator::FilterSolidHeightfield(FNavMeshBuildJob& Job)
+{
+	Job.SolidHF->FilterSpans();
+}
+
+void FNavMeshGenerator::CreateOpenHeightfield(FNavMeshBuildJob& Job)
+{
+	Job.OpenHF->InitializeParameters(Job.SolidHF, NavigationMesh->GetNavmeshController());
+	Job.OpenHF->FindOpenSpanData(Job.SolidHF);
+}
+
+void FNavMeshGenerator::GenerateOpenHeightfieldRegions(FNavMeshBuildJob& Job)
+{
+	UOpenHeightfield* OpenHF = Job.OpenHF;
 
 	if (OpenHF->GetPerformFullGeneration())
 	{
 		OpenHF->GenerateNeightborLinks();
-		OpenHF->GenerateDistanceField();
-		OpenHF->GenerateRegions();
+
+		//The monotone and layers partitioning don't need the distance field, the border spans are eroded directly
+		if (OpenHF->GetPartitioning() == RegionPartitioning::WATERSHED)
+		{
+			OpenHF->GenerateDistanceField();
+			OpenHF->BlurDistanceField();
+			OpenHF->GenerateRegions();
+		}
+		else
+		{
+			OpenHF->ErodeTraversableArea();
+			OpenHF->GenerateMonotoneRegions();
+		}
+	}
+}
+
+void FNavMeshGenerator::FilterOpenHeightfieldRegions(FNavMeshBuildJob& Job)
+{
+	UOpenHeightfield* OpenHF = Job.OpenHF;
+
+	if (OpenHF->GetPerformFullGeneration())
+	{
+		if (OpenHF->GetPartitioning() == RegionPartitioning::LAYERS)
+		{
+			OpenHF->MergeRegionLayers();
+		}
+
 		OpenHF->HandleSmallRegions();
-		OpenHF->ReassignBorderSpan();
+
+		//Only the watershed partitioning produces spans wrapping around the adjacent regions
+		if (OpenHF->GetPartitioning() == RegionPartitioning::WATERSHED)
+		{
+			OpenHF->ReassignBorderSpan();
+		}
 		/*OpenHF->CleanRegionBorders();*/
 	}
 }
 
-void FNavMeshGenerator::CreateContour()
+void FNavMeshGenerator::CreateContour(FNavMeshBuildJob& Job)
 {
-	Contour->InitializeParameters(OpenHF, NavigationMesh->GetNavmeshController());
-	Contour->GenerateContour(OpenHF);
+	Job.Contour->InitializeParameters(Job.OpenHF, NavigationMesh->GetNavmeshController());
+	Job.Contour->GenerateContour(Job.OpenHF);
 }
 
-void FNavMeshGenerator::CreatePolygonMesh()
+void FNavMeshGenerator::CreatePolygonMesh(FNavMeshBuildJob& Job)
 {
-	PolygonMesh->InitializeParameters(NavigationMesh->GetNavmeshController());
-	PolygonMesh->GeneratePolygonMesh(Contour, true, 0);
+	Job.PolygonMesh->InitializeParameters(NavigationMesh->GetNavmeshController());
+	Job.PolygonMesh->GeneratePolygonMesh(Job.Contour, true, 0);
 }
 
-void FNavMeshGenerator::CreateDetailedMesh()
+void FNavMeshGenerator::CreateDetailedMesh(FNavMeshBuildJob& Job)
 {
 }
 
 void FNavMeshGenerator::SendDataToNavmesh()
 {
-	NavigationMesh->SetResultingPoly(PolygonMesh->GetResultingPoly());
+	TArray<FPolygonData> ResultingPoly;
+
+	//Concatenate the polygons of all the jobs, the polygon indices are offset so that they stay unique
+	for (const FNavMeshBuildJob& Job : BuildJobs)
+	{
+		int IndexOffset = ResultingPoly.Num();
+
+		for (FPolygonData Polygon : Job.PolygonMesh->GetResultingPoly())
+		{
+			Polygon.Index += IndexOffset;
+
+			for (FPolygonData& AdjacentPolygon : Polygon.AdjacentPolygonList)
+			{
+				AdjacentPolygon.Index += IndexOffset;
+			}
+
+			ResultingPoly.Add(MoveTemp(Polygon));
+		}
+	}
+
+	NavigationMesh->SetResultingPoly(ResultingPoly);
 }
 
 void FNavMeshGenerator::SetNavmesh(ACustomNavigationData* NavMesh)
@@ -197,7 +653,19 @@ void FNavMeshGenerator::SetNavmesh(ACustomNavigationData* NavMesh)
 
 void FNavMeshGenerator::SetNavBounds()
 {
-	//Currently only the first bound is assigned to work with the custom navmesh
-	NavBounds = NavigationMesh->GetNavigableBounds()[0];
+	//Every bound is generated as a separate job
+	NavBounds = NavigationMesh->GetNavigableBounds();
+}
+
+const FBox FNavMeshGenerator::GetNavBounds() const
+{
+	FBox Bounds(ForceInit);
+
+	for (const FBox& NavBound : NavBounds)
+	{
+		Bounds += NavBound;
+	}
+
+	return Bounds;
 }
 
@@ -7,7 +7,11 @@
 #include "AI/NavDataGenerator.h"
 #include "Math/Box.h"
 #include "AI/Navigation/NavigationTypes.h"
+#include "SolidHeightfield.h"
 
+class UStaticMesh;
+class UInstancedStaticMeshComponent;
+class FStaticMeshRenderData;
 class USolidHeightfield;
 class UOpenHeightfield;
 class UContour;
@@ -16,6 +20,126 @@ class UDetailedMesh;
 class ANavMeshController;
 class ACustomNavigationData;
 
+/*Identify the spans generated by a mesh, the cached spans can be reused as long as all the values match
+  The render data is part of the key so that a rebuilt or reimported mesh is voxelized again*/
+struct FVoxelCacheKey
+{
+	const UStaticMesh* StaticMesh = nullptr;
+	const FStaticMeshRenderData* RenderData = nullptr;
+	FTransform Transform;
+	float CellSize = 0.f;
+	float CellHeight = 0.f;
+	float MaxTraversableAngle = 0.f;
+	uint8 GeometrySource = 0;
+	int GeometryLOD = 0;
+
+	//The spans are stored in grid coordinates, so they are only valid for the same grid
+	FVector FieldBoundMin = FVector::ZeroVector;
+	int FieldWidth = 0;
+	int FieldDepth = 0;
+
+	bool operator==(const FVoxelCacheKey& Other) const
+	{
+		return StaticMesh == Other.StaticMesh && RenderData == Other.RenderData && Transform.Equals(Other.Transform, 0.f) &&
+			CellSize == Other.CellSize && CellHeight == Other.CellHeight && MaxTraversableAngle == Other.MaxTraversableAngle &&
+			GeometrySource == Other.GeometrySource && GeometryLOD == Other.GeometryLOD &&
+			FieldBoundMin == Other.FieldBoundMin && FieldWidth == Other.FieldWidth && FieldDepth == Other.FieldDepth;
+	}
+
+	friend uint32 GetTypeHash(const FVoxelCacheKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.StaticMesh), GetTypeHash(Key.RenderData));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Transform.GetLocation()));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Transform.GetRotation().Euler()));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Transform.GetScale3D()));
+		Hash = HashCombine(Hash, GetTypeHash(Key.FieldBoundMin));
+		Hash = HashCombine(Hash, GetTypeHash(Key.GeometrySource) ^ GetTypeHash(Key.GeometryLOD));
+		return HashCombine(Hash, GetTypeHash(Key.CellSize) ^ GetTypeHash(Key.CellHeight) ^ GetTypeHash(Key.MaxTraversableAngle));
+	}
+};
+
+//Number of steps in which a cell is divided to locate the origin of a voxel template inside it
+#define TEMPLATE_FRACTION_STEPS 1024
+
+//Number of steps in which a degree is divided to compare the rotation of the voxel templates
+#define TEMPLATE_ROTATION_STEPS 100
+
+/*Identify a voxel template, the instances with the same key only differ by an integer number of cells (and quarter turns around the up axis)
+  The location of the origin inside its cell and the rotation are quantized, so instances placed almost at the same offset share the template*/
+struct FVoxelTemplateKey
+{
+	const UStaticMesh* StaticMesh = nullptr;
+	const FStaticMeshRenderData* RenderData = nullptr;
+
+	//Pitch, yaw and roll in TEMPLATE_ROTATION_STEPS of a degree
+	FIntVector Rotation = FIntVector::ZeroValue;
+	FVector Scale = FVector::OneVector;
+
+	//Location of the origin inside its cell in TEMPLATE_FRACTION_STEPS of a cell
+	FIntVector Fraction = FIntVector::ZeroValue;
+
+	float CellSize = 0.f;
+	float CellHeight = 0.f;
+	float MaxTraversableAngle = 0.f;
+	uint8 GeometrySource = 0;
+	int GeometryLOD = 0;
+
+	bool operator==(const FVoxelTemplateKey& Other) const
+	{
+		return StaticMesh == Other.StaticMesh && RenderData == Other.RenderData && Rotation == Other.Rotation && Scale == Other.Scale &&
+			Fraction == Other.Fraction && CellSize == Other.CellSize && CellHeight == Other.CellHeight && MaxTraversableAngle == Other.MaxTraversableAngle &&
+			GeometrySource == Other.GeometrySource && GeometryLOD == Other.GeometryLOD;
+	}
+
+	friend uint32 GetTypeHash(const FVoxelTemplateKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.StaticMesh), GetTypeHash(Key.RenderData));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Rotation));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Scale));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Fraction));
+		Hash = HashCombine(Hash, GetTypeHash(Key.GeometrySource) ^ GetTypeHash(Key.GeometryLOD));
+		return HashCombine(Hash, GetTypeHash(Key.CellSize) ^ GetTypeHash(Key.CellHeight) ^ GetTypeHash(Key.MaxTraversableAngle));
+	}
+};
+
+//Single instance of an instanced static mesh component overlapping the nav bounds
+struct FNavMeshInstance
+{
+	const UInstancedStaticMeshComponent* Mesh = nullptr;
+	FTransform Transform;
+
+	//World bounds of the instance
+	FBox Bounds = FBox(ForceInit);
+};
+
+//Number of cells added around every chunk of a chunked build, the solid span filters only look at the adjacent columns
+//so a single cell is enough for the spans of the chunk to be filtered in the same way as in a full build
+#define CHUNK_BORDER_SIZE 1
+
+//Voxel data used during the current build, it replaces the caches once all the nav bounds are generated
+//so that the data of the meshes no longer present is discarded
+struct FNavMeshBuildCache
+{
+	TMap<FVoxelCacheKey, FHeightSpanColumns> Spans;
+	TMap<FVoxelTemplateKey, FVoxelTemplate> Templates;
+};
+
+/*Generation of a single nav bounds volume, every volume has its own heightfields, contour and polygons
+  The stages that create UObjects or access the components run on the game thread, the other ones run in parallel for all the volumes*/
+struct FNavMeshBuildJob
+{
+	FBox NavBounds = FBox(ForceInit);
+	TArray<UStaticMeshComponent*> Geometries;
+	TArray<FNavMeshInstance> Instances;
+
+	//The pointer to the objects are saved to access the debug functions located in the controller
+	USolidHeightfield* SolidHF = nullptr;
+	UOpenHeightfield* OpenHF = nullptr;
+	UContour* Contour = nullptr;
+	UPolygonMesh* PolygonMesh = nullptr;
+	UDetailedMesh* DetailedMesh = nullptr;
+};
+
 class NAVMESH_GENERATION_API FNavMeshGenerator : public FNavDataGenerator
 {
 public:	
@@ -26,52 +150,84 @@ public:
 
 	virtual void RebuildDirtyAreas(const TArray<FNavigationDirtyArea>& DirtyAreas);
 
-	//Gather all the valid geometry in the level, meaning the overlapping ones, world static, that can affect navigation
+	//Create a build job for every nav bounds and gather all the valid geometry inside it, meaning the overlapping ones, world static, that can affect navigation
+	//All the static mesh components of the actors are considered, the instanced ones are gathered per instance
 	void GatherValidOverlappingGeometries();
 
-	//Generate the navmesh
+	//Add the instances of the component overlapping the nav bounds of the job
+	void GatherMeshInstances(const UInstancedStaticMeshComponent* Mesh, FNavMeshBuildJob& Job);
+
+	//Generate the navmesh of all the nav bounds
 	void GenerateNavmesh();
 
-	//Initialize all the UObject needed for creating the navmesh
-	void InitializeNavmeshObjects();
+	//Initialize all the UObject needed for creating the navmesh of the job
+	void InitializeNavmeshObjects(FNavMeshBuildJob& Job);
+
+	/*Create the open heightfield covering the whole field by building the solid heightfield one chunk (of ChunkSize cells) at a time
+	  The solid spans of every chunk are filtered, converted to open spans and then released before moving to the next chunk*/
+	void CreateChunkedOpenHeightfield(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const FVector AreaCenter, const FVector AreaExtent);
+
+	/*Create the solid heightfield by voxelizing all the geometries in parallel and merging the results in order
+	  The meshes found in the voxel cache are merged directly without being voxelized again, the spans used are added to UsedCache
+	  When the heightfield only covers a chunk, the meshes outside of it are skipped and the voxel cache is bypassed*/
+	void CreateSolidHeightfield(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const bool IsChunk = false);
+
+	//Build the key used to find the spans of the mesh inside the voxel cache
+	FVoxelCacheKey GetVoxelCacheKey(const UStaticMeshComponent* Mesh, const USolidHeightfield* SolidField) const;
+
+	/*Retrieve the geometry to voxelize for the mesh based on the GeometrySource selected in the controller, transformed by the transform passed in
+	  The render mesh is used when the simple collision is selected but the mesh has none*/
+	void GatherMeshGeometry(const UStaticMeshComponent* Mesh, const FTransform& Transform, FVoxelGeometry& OutGeometry) const;
 
-	//Create the solid heightfield and return the voxel data
-	void CreateSolidHeightfield(const UStaticMeshComponent* Mesh);
+	/*Voxelize the instances gathered through their templates and merge them into the solid heightfield
+	  Every template is voxelized once (in parallel) and then replayed for all the instances sharing it
+	  The templates are taken from UsedCache or moved there from the template cache, and only voxelized when not found in either*/
+	void CreateInstancesSpans(FNavMeshBuildJob& Job, FNavMeshBuildCache& UsedCache, const bool IsChunk);
+
+	//Find the template used by the instance and the cell and number of quarter turns the template needs to be placed with
+	void GetInstancePlacement(const FNavMeshInstance& Instance, const USolidHeightfield* SolidField, FVoxelTemplateKey& OutKey, FIntVector& OutCell, int& OutQuarterTurns) const;
+
+	//Remove the walkable flag from the solid spans that are too low or next to a ledge, performed once all the geometries are voxelized
+	void FilterSolidHeightfield(FNavMeshBuildJob& Job);
 
 	//Create an open heightfield based on the data retrieved from the solid one and return it
-	void CreateOpenHeightfield();
+	void CreateOpenHeightfield(FNavMeshBuildJob& Job);
+
+	//Generate the neighbor links, the distance field and the regions of the open heightfield
+	void GenerateOpenHeightfieldRegions(FNavMeshBuildJob& Job);
+
+	//Remove or merge the small regions and fix the border spans
+	void FilterOpenHeightfieldRegions(FNavMeshBuildJob& Job);
 
 	//Create the contours that define the traversable area of the geometries
-	void CreateContour();
+	void CreateContour(FNavMeshBuildJob& Job);
 
 	//Create the polygons forming the navmesh using the contours data
-	void CreatePolygonMesh();
+	void CreatePolygonMesh(FNavMeshBuildJob& Job);
 
 	//Create a polygon mesh with detailed height information
-	void CreateDetailedMesh();
+	void CreateDetailedMesh(FNavMeshBuildJob& Job);
 
-	//Pass the polygon data from the generator to the navmesh
+	//Pass the polygon data of all the jobs from the generator to the navmesh
 	void SendDataToNavmesh();
 
 	void SetNavmesh(ACustomNavigationData* NavMesh);
 	void SetNavBounds();
 
-	const FBox GetNavBounds() const { return NavBounds; }
-	USolidHeightfield* GetSolidHeightfield() const { return SolidHF; }
-	UOpenHeightfield* GetOpenHeightfield() const { return OpenHF; }
-	UContour* GetContour() const { return Contour; }
-	UPolygonMesh* GetPolygonMesh() const { return PolygonMesh; }
-	UDetailedMesh* GetDetailedMesh() const { return DetailedMesh; }
+	//Bounding box containing all the nav bounds
+	const FBox GetNavBounds() const;
+	const TArray<FNavMeshBuildJob>& GetBuildJobs() const { return BuildJobs; }
 
 private:
-	FBox NavBounds;
-	TArray<UStaticMeshComponent*> Geometries;
+	TArray<FBox> NavBounds;
+
+	//One job for every nav bounds containing valid geometries
+	TArray<FNavMeshBuildJob> BuildJobs;
+
+	//Spans generated by the meshes during the last build, the entries of meshes no longer present are discarded at every build
+	TMap<FVoxelCacheKey, FHeightSpanColumns> VoxelCache;
+
+	//Voxel templates used by the instances during the last build
+	TMap<FVoxelTemplateKey, FVoxelTemplate> TemplateCache;
 	ACustomNavigationData* NavigationMesh;
-	
-	//The pointer to the objects are saved to access the debug functions located in the controller
-	USolidHeightfield* SolidHF;
-	UOpenHeightfield* OpenHF;
-	UContour* Contour;
-	UPolygonMesh* PolygonMesh;
-	UDetailedMesh* DetailedMesh;
 };
@@ -4,12 +4,22 @@
 #include "OpenHeightfield.h"
 #include "SolidHeightfield.h"
 #include "NavMeshController.h"
+#include "../Navmesh_Generation.h"
 #include "Engine/TextRenderActor.h"
 #include "Region.h"
 #include "../Utility/MeshDebug.h"
 #include "Components/TextRenderComponent.h"
-#include "Kismet/KismetMathLibrary.h"
 #include "../Utility/UtilityDebug.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Unique.h"
+
+DECLARE_CYCLE_STAT(TEXT("Generate neighbor links"), STAT_GenerateNeighborLinks, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Distance field (vectorized)"), STAT_DistanceFieldVectorized, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Distance field (scalar)"), STAT_DistanceFieldScalar, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Blur distance field"), STAT_BlurDistanceField, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Erode traversable area"), STAT_ErodeTraversableArea, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Monotone regions"), STAT_MonotoneRegions, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Gather regions data"), STAT_GatherRegionsData, STATGROUP_NavMeshGeneration);
 
 void UOpenHeightfield::InitializeParameters(const USolidHeightfield* SolidHeightfield, const ANavMeshController* NavController)
 {
@@ -21,48 +31,92 @@ void UOpenHeightfield::InitializeParameters(const USolidHeightfield* SolidHeight
 	CellHeight = NavController->CellHeight;
 	MinTraversableHeight = NavController->MinTraversableHeight;
 	MaxTraversableStep = NavController->MaxTraversableStep;
+	SmoothingThreshold = NavController->SmoothingThreshold;
 
 	TraversableAreaBorderSize = NavController->TraversableAreaBorderSize;
 	MinMergeRegionSize = NavController->MinMergeRegionSize;
 	MinUnconnectedRegionSize = NavController->MinUnconnectedRegionSize;
 	PerformFullGeneration = NavController->PerformFullGeneration;
 	UseConservativeExpansion = NavController->UseConservativeExpansion;
+	Partitioning = NavController->Partitioning;
+	EnableVectorization = NavController->EnableVectorization;
 
 	CalculateWidthDepthHeight();
+	ResetOccupiedRows();
+
+	//Every column starts empty, the spans are added by FindOpenSpanData
+	Cells.Empty();
+	Cells.SetNumZeroed(Width * Depth);
+	Spans.Empty();
 }
 
 void UOpenHeightfield::FindOpenSpanData(const USolidHeightfield* SolidHeightfield)
+{
+	FindOpenSpanData(SolidHeightfield, FIntRect(0, 0, Width, Depth));
+}
+
+void UOpenHeightfield::FindOpenSpanData(const USolidHeightfield* SolidHeightfield, const FIntRect& Area)
 {
 	if (!SolidHeightfield)
 	{
 		return;
 	}
 
-	//Iterate through the span of the solid heightfield
-	for (auto& It : SolidHeightfield->GetSpans())
+	const FHeightSpanPool& SolidSpans = SolidHeightfield->GetSpanPool();
+
+	const TArray<uint32>& SolidColumns = SolidHeightfield->GetSpans();
+	const int SolidWidth = SolidHeightfield->GetWidth();
+
+	//Location of the first solid column inside the grid of the open heightfield
+	const int OffsetWidth = FMath::RoundToInt((SolidHeightfield->GetBoundMin().X - BoundMin.X) / CellSize);
+	const int OffsetDepth = FMath::RoundToInt((SolidHeightfield->GetBoundMin().Y - BoundMin.Y) / CellSize);
+
+	//Set once the cells can't index any more spans
+	bool SpanLimitReached = false;
+
+	//Iterate through the span of the solid heightfield, row by row
+	for (int SolidIndex = 0; SolidIndex < SolidColumns.Num(); SolidIndex++)
 	{
-		UHeightSpan* CurrentSpan = It.Value;
+		const FIntPoint Cell(OffsetWidth + SolidIndex % SolidWidth, OffsetDepth + SolidIndex / SolidWidth);
+
+		//Skip the columns outside of the area, like the border of a chunk
+		if (!Area.Contains(Cell))
+		{
+			continue;
+		}
+
+		int GridIndex = GetGridIndex(Cell.X, Cell.Y);
+
+		if (GridIndex == -1)
+		{
+			continue;
+		}
 
-		UOpenSpan* BaseSpan = nullptr;
-		UOpenSpan* PreviousSpan = nullptr;
+		uint32 CurrentIndex = SolidColumns[SolidIndex];
+
+		//The spans of the column are added one after the other, starting from the lowest one
+		const int FirstSpan = Spans.Num();
+		int SpanCount = 0;
 
 		//As long as there's a span valid in the column considered
-		while (CurrentSpan)
+		while (CurrentIndex != NULL_SPAN)
 		{
+			const FHeightSpan& CurrentSpan = SolidSpans[CurrentIndex];
+			CurrentIndex = CurrentSpan.NextSpan;
+
 			//Check if it's walkable, if not skip to the next one in the column
-			if (CurrentSpan->SpanAttribute == PolygonType::UNWALKABLE)
+			if (CurrentSpan.Area == NULL_AREA)
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
 				continue;
 			}
 
 			//Determine the open space between this span and the next higher span
-			int Floor = CurrentSpan->Max;
+			int Floor = CurrentSpan.Max;
 			int Ceiling;
 
-			if (CurrentSpan->nextSpan)
+			if (CurrentSpan.NextSpan != NULL_SPAN)
 			{
-				Ceiling = CurrentSpan->nextSpan->Min;
+				Ceiling = SolidSpans[CurrentSpan.NextSpan].Min;
 			}
 			else
 			{
@@ -72,135 +126,202 @@ void UOpenHeightfield::FindOpenSpanData(const USolidHeightfield* SolidHeightfiel
 			//And check if it can be traversed or not
 			if ((Ceiling - Floor) * CellHeight < MinTraversableHeight)
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
 				continue;
 			}
 
-			UOpenSpan* NewSpan = NewObject<UOpenSpan>(UOpenSpan::StaticClass());
-			NewSpan->Width = CurrentSpan->Width;
-			NewSpan->Depth = CurrentSpan->Depth;
-			NewSpan->Min = Floor;
-			NewSpan->Max = Ceiling;
-
-			//Create a new span and add it to the array of open span if it's the first in the column
-			if (!BaseSpan)
+			//The neighbors are referenced by their layer, so the spans above the last layer can't be linked
+			if (SpanCount == NOT_CONNECTED)
 			{
-				BaseSpan = NewSpan;
+				UE_LOG(LogTemp, Warning, TEXT("Too many open spans in the column %d %d, the spans above the limit are discarded"), Cell.X, Cell.Y);
+				break;
 			}
 
-			if (PreviousSpan)
+			//The cells can't index more spans, all the remaining ones are discarded
+			if (Spans.Num() == OPEN_SPAN_MAX_COUNT)
 			{
-				//Otherwise there is a span at a lower location, link it (previous) span to this span
-				PreviousSpan->nextSpan = NewSpan;
+				UE_LOG(LogTemp, Warning, TEXT("Too many open spans in the heightfield (%d), the remaining spans are discarded"), OPEN_SPAN_MAX_COUNT);
+				SpanLimitReached = true;
+				break;
 			}
-			
-			//Progress in scaling the column by updating the values of the previous and current span until the loop is complete
-			PreviousSpan = NewSpan;
-			CurrentSpan = CurrentSpan->nextSpan;
+
+			//The solid heightfield grid is aligned to this one, the span position is implied by the column index
+			FOpenSpan& NewSpan = Spans.AddDefaulted_GetRef();
+			NewSpan.Width = Cell.X;
+			NewSpan.Depth = Cell.Y;
+			NewSpan.Min = Floor;
+			NewSpan.Max = FMath::Min(Ceiling, OPEN_SPAN_MAX_HEIGHT);
+
+			SpanCount++;
+		}
+
+		if (SpanCount > 0)
+		{
+			Cells[GridIndex].Index = FirstSpan;
+			Cells[GridIndex].Count = SpanCount;
+			MarkOccupiedCells(Cell.X, Cell.Y, Cell.X, Cell.Y);
 		}
 
-		if (BaseSpan)
+		if (SpanLimitReached)
 		{
-			Spans.Add(It.Key, BaseSpan);
+			break;
 		}
 	}
+
+	//The data of the later stages starts empty for every span, zero is also the NULL_REGION
+	BorderDistances.SetNumZeroed(Spans.Num());
+	RegionCoreDistances.SetNumZeroed(Spans.Num());
+	RegionIDs.SetNumZeroed(Spans.Num());
 }
 
-void UOpenHeightfield::GenerateNeightborLinks()
+void UOpenHeightfield::SortSpans()
 {
-	//Iterate through all the base span
-	for (auto& Span : Spans)
+	TArray<FOpenSpan> SortedSpans;
+	SortedSpans.Reserve(Spans.Num());
+
+	//The cells are stored row by row, copying the columns in the cells order sorts the spans as well
+	//Only the first span of the column changes, the neighbor links are based on the layers and are generated later anyway
+	for (FOpenHeightfieldCell& Cell : Cells)
 	{
-		//As long as the current span has a next span valid
-		UOpenSpan* CurrentSpan = Span.Value;
+		const int FirstSpan = SortedSpans.Num();
 
-		do
+		for (uint32 Layer = 0; Layer < Cell.Count; Layer++)
 		{
-			//Find the neightbor span in the same way done in the solid heightfield
-			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
-			{
-				int NeighborWidth = CurrentSpan->Width + GetDirOffSetWidth(NeighborDir);
-				int NeighborDepth = CurrentSpan->Depth + GetDirOffSetDepth(NeighborDir);
+			SortedSpans.Add(Spans[Cell.Index + Layer]);
+		}
 
-				int NeightborIndex = GetGridIndex(NeighborWidth, NeighborDepth);
+		Cell.Index = FirstSpan;
+	}
 
-				//If the neightbor span is valid
-				if (Spans.Contains(NeightborIndex))
-				{
-					UOpenSpan* NeighborSpan = *Spans.Find(NeightborIndex);
+	Spans = MoveTemp(SortedSpans);
+}
 
-					do {
+int UOpenHeightfield::GetAxisNeighbor(const int SpanIndex, const int Direction) const
+{
+	const FOpenSpan& Span = Spans[SpanIndex];
+	const int Layer = Span.GetConnection(Direction);
 
-						//Check if the different in height between 2 neightbor spans is large enough for an agent to pass through
-						int MaxFloor = FMath::Max(CurrentSpan->Min, NeighborSpan->Min);
-						int MinCeiling = FMath::Min(CurrentSpan->Max, NeighborSpan->Max);
+	if (Layer == NOT_CONNECTED)
+	{
+		return NULL_OPEN_SPAN;
+	}
 
-						if ((MinCeiling - MaxFloor) * CellHeight >= MinTraversableHeight && UKismetMathLibrary::Abs(NeighborSpan->Min - CurrentSpan->Min) * CellHeight <= MaxTraversableStep)
-						{
-							//And if it is set the neighbor span and exit the loop
-							CurrentSpan->SetAxisNeighbor(NeighborDir, NeighborSpan);
-							break;
-						}
+	//The connections are only set for the neighbors inside the grid
+	const int NeighborIndex = GetGridIndex(Span.Width + GetDirOffSetWidth(Direction), Span.Depth + GetDirOffSetDepth(Direction));
 
-						//Iterate through the span of a neighbor column as there could be multiple span in it and the first one found could not be valid
-						NeighborSpan = NeighborSpan->nextSpan;
-					} 
-					while (NeighborSpan);
-				}
-			}
+	return Cells[NeighborIndex].Index + Layer;
+}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+int UOpenHeightfield::GetDiagonalNeighbor(const int SpanIndex, const int Direction) const
+{
+	if (Direction == 3)
+	{
+		return GetAxisNeighbor(SpanIndex, 0);
 	}
+
+	return GetAxisNeighbor(SpanIndex, Direction + 1);
 }
 
-void UOpenHeightfield::FindBorderSpan()
+const FOpenHeightfieldCell& UOpenHeightfield::GetSpanCell(const int SpanIndex) const
 {
-	for (auto& Span : Spans)
+	const FOpenSpan& Span = Spans[SpanIndex];
+
+	return Cells[Span.Depth * Width + Span.Width];
+}
+
+void UOpenHeightfield::GenerateNeightborLinks()
+{
+	SCOPE_CYCLE_COUNTER(STAT_GenerateNeighborLinks);
+
+	//Every span only writes its own connections and reads the other spans heights, so the rows are processed in parallel
+	//The result doesn't depend on the order in which the rows are processed
+	ParallelFor(FMath::Max(OccupiedDepthMax - OccupiedDepthMin + 1, 0), [&](int32 It)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		GenerateRowNeighborLinks(OccupiedDepthMin + It);
+	});
+}
 
-		do
+void UOpenHeightfield::GenerateRowNeighborLinks(const int DepthIndex)
+{
+	//Iterate through the spans of the occupied part of the row
+	for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
+	{
+		const FOpenHeightfieldCell& Cell = Cells[GetGridIndex(WidthIndex, DepthIndex)];
+
+		for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
 		{
-			bool IsBorder = false;
+			FOpenSpan& CurrentSpan = Spans[SpanIndex];
 
-			//Iterate through the neighbor span, both axis and diagonal ones (8 neighbor surrounding the one considered)
+			//Find the neightbor span in the same way done in the solid heightfield
 			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
 			{
-				UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
-				
-				//If one axis is not valid, then we are sure the span we are considering is a border span and we can exit the loop
-				if (!NeighborSpan)
+				int NeightborIndex = GetGridIndex(WidthIndex + GetDirOffSetWidth(NeighborDir), DepthIndex + GetDirOffSetDepth(NeighborDir));
+
+				if (NeightborIndex == -1)
 				{
-					IsBorder = true;
-					break;
+					continue;
 				}
-				
-				//Same for the neighbor spans
-				UOpenSpan* DiagonalNeightborSpan = NeighborSpan->GetDiagonalNeighbor(NeighborDir);
 
-				if (!DiagonalNeightborSpan)
+				//Iterate through the span of a neighbor column as there could be multiple span in it and the first one found could not be valid
+				const FOpenHeightfieldCell& NeighborCell = Cells[NeightborIndex];
+
+				for (uint32 Layer = 0; Layer < NeighborCell.Count; Layer++)
 				{
-					IsBorder = true;
-					break;
+					const FOpenSpan& NeighborSpan = Spans[NeighborCell.Index + Layer];
+
+					//Check if the different in height between 2 neightbor spans is large enough for an agent to pass through
+					int MaxFloor = FMath::Max(CurrentSpan.Min, NeighborSpan.Min);
+					int MinCeiling = FMath::Min(CurrentSpan.Max, NeighborSpan.Max);
+
+					if ((MinCeiling - MaxFloor) * CellHeight >= MinTraversableHeight && FMath::Abs(NeighborSpan.Min - CurrentSpan.Min) * CellHeight <= MaxTraversableStep)
+					{
+						//And if it is set the neighbor span and exit the loop
+						CurrentSpan.SetConnection(NeighborDir, Layer);
+						break;
+					}
 				}
 			}
+		}
+	}
+}
+
+void UOpenHeightfield::FindBorderSpan()
+{
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
+	{
+		bool IsBorder = false;
+
+		//Iterate through the neighbor span, both axis and diagonal ones (8 neighbor surrounding the one considered)
+		for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+		{
+			int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
 
-			//Based on the data found, the DistanceToBorder variable is set to 0, if it's a border span
-			//or to a default value which indicates that the current distance of the span is unknown
-			if (IsBorder)
+			//If one axis is not valid, then we are sure the span we are considering is a border span and we can exit the loop
+			if (NeighborSpan == NULL_OPEN_SPAN)
 			{
-				CurrentSpan->DistanceToBorder = 0;
+				IsBorder = true;
+				break;
 			}
-			else
+
+			//Same for the neighbor spans
+			int DiagonalNeightborSpan = GetDiagonalNeighbor(NeighborSpan, NeighborDir);
+
+			if (DiagonalNeightborSpan == NULL_OPEN_SPAN)
 			{
-				CurrentSpan->DistanceToBorder = REGION_MAX_BORDER;
+				IsBorder = true;
+				break;
 			}
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+		//Based on the data found, the DistanceToBorder variable is set to 0, if it's a border span
+		//or to a default value which indicates that the current distance of the span is unknown
+		if (IsBorder)
+		{
+			BorderDistances[SpanIndex] = 0;
+		}
+		else
+		{
+			BorderDistances[SpanIndex] = REGION_MAX_BORDER;
+		}
 	}
 }
 
@@ -208,118 +329,335 @@ void UOpenHeightfield::GenerateDistanceField()
 {
 	FindBorderSpan();
 
-	//Iterate through all the spans to make sure they are iterated upon in order
-	
-	//This could also be achieved by using a sorted map instead of an unsorted one, but 
-	//1 - because only this passage step of the algorithm requires this general loop and the overhead of a sorted map can become quite considerable
-	//2 - because there is no way in Unreal to easily reverse a map (needed in the second part of the algorithm)
-	//This solution is preferred
-	for (int DepthIndex = 0; DepthIndex <= Depth; DepthIndex++)
+	//Chamfer distance transform, the axis neighbors are 2 away and the diagonal ones 3 away (approximation of 1 and sqrt(2))
+	//A forward pass propagates the distances from the -X and -Y sides and a backward one from the +X and +Y sides
+	if (EnableVectorization && HasSingleLayerColumns())
 	{
-		for (int WidthIndex = 0; WidthIndex <= Width; ++WidthIndex)
+		SCOPE_CYCLE_COUNTER(STAT_DistanceFieldVectorized);
+
+		GenerateDistanceFieldSingleLayer();
+	}
+	else
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DistanceFieldScalar);
+
+		GenerateDistanceFieldScalar();
+	}
+}
+
+void UOpenHeightfield::GenerateDistanceFieldScalar()
+{
+	//The spans are stored row by row, so they are iterated in order in the forward pass and in reverse order in the backward one
+	//Only the occupied part of every row is iterated
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
+	{
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; ++WidthIndex)
 		{
-			int GridIndex = GetGridIndex(WidthIndex, DepthIndex);
-			
-			//Check if the span is contained in the map of valid open span
-			if (Spans.Contains(GridIndex))
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+			for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
 			{
-				UOpenSpan* CurrentSpan = *Spans.Find(GridIndex);
+				//If the distance is equal to 0 the span is a border span and it can be skipped
+				if (BorderDistances[SpanIndex] != 0)
+				{
+					BorderDistances[SpanIndex] = GetChamferDistance(SpanIndex, 0);
+				}
+			}
+		}
+	}
 
-				do
+	//After the backward pass all the span distances are set, with no one having the REGION_MAX_BORDER value
+	for (int DepthIndex = OccupiedDepthMax; DepthIndex >= OccupiedDepthMin; DepthIndex--)
+	{
+		for (int WidthIndex = RowWidthMax[DepthIndex]; WidthIndex >= RowWidthMin[DepthIndex]; WidthIndex--)
+		{
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+			for (int SpanIndex = Cell.Index + Cell.Count - 1; SpanIndex >= int(Cell.Index); SpanIndex--)
+			{
+				if (BorderDistances[SpanIndex] != 0)
 				{
-					int Distance = CurrentSpan->DistanceToBorder;
+					BorderDistances[SpanIndex] = GetChamferDistance(SpanIndex, 2);
 
-					//If the distance is equal to 0 the span is a border span and it can be skipped
-					if (Distance == 0)
-					{
-						CurrentSpan = CurrentSpan->nextSpan;
-						continue;
-					}
+					//Find the min and max distance from the border
+					CalculateBorderDistanceMinMax(BorderDistances[SpanIndex]);
+				}
+			}
+		}
+	}
+}
 
-					//Create an array an put in it all the value retrieved from the neightbor span both axis
-					TArray<int> TempContainer;
+int UOpenHeightfield::GetChamferDistance(const int SpanIndex, const int FirstDirection) const
+{
+	int Distance = BorderDistances[SpanIndex];
 
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(0)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(1)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(2)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(3)->DistanceToBorder);
+	for (int NeighborDir = FirstDirection; NeighborDir < FirstDirection + 2; NeighborDir++)
+	{
+		const int AxisSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
 
+		if (AxisSpan == NULL_OPEN_SPAN)
+		{
+			continue;
+		}
 
-					//And diagonal ones (for these an additional check for their validity is required)
-					//To check the diagonal one we use the axis neighbor of a neighbor span
-					for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
-					{
-						UOpenSpan* NeightborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
-						UOpenSpan* DiagonalNeightborSpan = CurrentSpan->GetDiagonalNeighbor(NeighborDir);
+		Distance = FMath::Min<int>(Distance, BorderDistances[AxisSpan] + 2);
 
-						if (DiagonalNeightborSpan)
-						{
-							TempContainer.Add(DiagonalNeightborSpan->DistanceToBorder);
-						}
-					}
+		//The diagonal neighbor is reached through the axis one, by moving in the next direction (clockwise)
+		const int DiagonalSpan = GetDiagonalNeighbor(AxisSpan, NeighborDir);
 
-					//Find the current min distance of all the neighbor span
-					int MinDistance = FMath::Min(TempContainer);
+		if (DiagonalSpan != NULL_OPEN_SPAN)
+		{
+			Distance = FMath::Min<int>(Distance, BorderDistances[DiagonalSpan] + 3);
+		}
+	}
 
-					//Set the current distance equal to the min found + a small amount
-					CurrentSpan->DistanceToBorder = MinDistance + 2;
+	return Distance;
+}
 
-					CurrentSpan = CurrentSpan->nextSpan;
-				} while (CurrentSpan);
+bool UOpenHeightfield::HasSingleLayerColumns() const
+{
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
+	{
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; ++WidthIndex)
+		{
+			if (Cells[DepthIndex * Width + WidthIndex].Count > 1)
+			{
+				return false;
 			}
 		}
 	}
 
-	//Reverse iteration of the algortihm needed because a single iteration is not enough to establish the exact value of some span distance
-	//In this second iteration all the span distance are initiliazed properly with no one having the REGION_MAX_BORDER value
-	//Same logic as before, comments above
-	for (int DepthIndex = Depth; DepthIndex >= 0; DepthIndex--)
+	return true;
+}
+
+void UOpenHeightfield::GenerateDistanceFieldSingleLayer()
+{
+	//Columns covered by the occupied rows
+	int AreaWidthMin = Width;
+	int AreaWidthMax = -1;
+
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
 	{
-		for (int WidthIndex = Width; WidthIndex >= 0; WidthIndex--)
+		AreaWidthMin = FMath::Min(AreaWidthMin, RowWidthMin[DepthIndex]);
+		AreaWidthMax = FMath::Max(AreaWidthMax, RowWidthMax[DepthIndex]);
+	}
+
+	if (AreaWidthMax < AreaWidthMin)
+	{
+		return;
+	}
+
+	const int AreaWidth = AreaWidthMax - AreaWidthMin + 1;
+	const int AreaDepth = OccupiedDepthMax - OccupiedDepthMin + 1;
+
+	/*Dense copy of the area, with an empty column on both sides of every row and an empty row before the first and after the last one
+	  The row stride is a multiple of the vector size and leaves room for the loads of the next column of the last vector*/
+	const int Stride = Align(AreaWidth + 5, 4);
+
+	//Distance of the span of every cell and bitmask of the directions it is connected to, 0 for the empty cells
+	TArray<int32> Distances;
+	TArray<int32> Connections;
+	Distances.SetNumZeroed(Stride * (AreaDepth + 2));
+	Connections.SetNumZeroed(Stride * (AreaDepth + 2));
+
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
+	{
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; ++WidthIndex)
 		{
-			int GridIndex = GetGridIndex(WidthIndex, DepthIndex);
-			if (Spans.Contains(GridIndex))
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+			if (Cell.Count == 0)
 			{
-				UOpenSpan* CurrentSpan = *Spans.Find(GridIndex);
+				continue;
+			}
 
-				do
+			const int DenseIndex = (DepthIndex - OccupiedDepthMin + 1) * Stride + WidthIndex - AreaWidthMin + 1;
+			int ConnectionBits = 0;
+
+			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+			{
+				if (Spans[Cell.Index].GetConnection(NeighborDir) != NOT_CONNECTED)
 				{
-					int Distance = CurrentSpan->DistanceToBorder;
+					ConnectionBits |= 1 << NeighborDir;
+				}
+			}
 
-					if (Distance == 0)
-					{
-						CurrentSpan = CurrentSpan->nextSpan;
-						continue;
-					}
+			Distances[DenseIndex] = BorderDistances[Cell.Index];
+			Connections[DenseIndex] = ConnectionBits;
+		}
+	}
 
-					TArray<int> TempContainer;
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(0)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(1)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(2)->DistanceToBorder);
-					TempContainer.Add(CurrentSpan->GetAxisNeighbor(3)->DistanceToBorder);
+	const VectorRegisterInt AxisCost = MakeVectorRegisterInt(2, 2, 2, 2);
+	const VectorRegisterInt DiagonalCost = MakeVectorRegisterInt(3, 3, 3, 3);
+	const VectorRegisterInt MaxDistance = MakeVectorRegisterInt(REGION_MAX_BORDER, REGION_MAX_BORDER, REGION_MAX_BORDER, REGION_MAX_BORDER);
 
-					for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
-					{
-						UOpenSpan* NeightborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
-						UOpenSpan* DiagonalNeightborSpan = CurrentSpan->GetDiagonalNeighbor(NeighborDir);
+	VectorRegisterInt DirectionBits[4];
 
-						if (DiagonalNeightborSpan)
-						{
-							TempContainer.Add(DiagonalNeightborSpan->DistanceToBorder);
-						}
-					}
-					
-					int MinDistance = FMath::Min(TempContainer);
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+	{
+		DirectionBits[NeighborDir] = MakeVectorRegisterInt(1 << NeighborDir, 1 << NeighborDir, 1 << NeighborDir, 1 << NeighborDir);
+	}
+
+	//Lanes set where the cell is connected in the direction passed in
+	auto IsConnected = [&DirectionBits](const VectorRegisterInt& Bits, const int Direction)
+	{
+		return VectorIntCompareEQ(VectorIntAnd(Bits, DirectionBits[Direction]), DirectionBits[Direction]);
+	};
+
+	//Distance of the cell through a neighbor, left unchanged for the lanes where the neighbor can't be reached
+	auto ReduceDistance = [&MaxDistance](const VectorRegisterInt& Distance, const VectorRegisterInt& Mask, const VectorRegisterInt& NeighborDistance, const VectorRegisterInt& Cost)
+	{
+		return VectorIntMin(Distance, VectorIntSelect(Mask, VectorIntAdd(NeighborDistance, Cost), MaxDistance));
+	};
+
+	/*Every row is processed in two steps, the neighbors in the adjacent row (axis and diagonal) don't depend on the current row so 4 columns are processed at once
+	  The neighbor in the same row depends on the previous column, so it is propagated by a scalar sweep along the row
+	  Taking the minimum in this order gives the same result as processing the neighbors of every span together*/
+	for (int Row = 1; Row <= AreaDepth; Row++)
+	{
+		const int RowStart = Row * Stride;
+
+		for (int Column = 1; Column <= AreaWidth; Column += 4)
+		{
+			const int DenseIndex = RowStart + Column;
+
+			const VectorRegisterInt Bits = VectorIntLoad(&Connections[DenseIndex]);
+			const VectorRegisterInt HasUp = IsConnected(Bits, 1);
+
+			//-Y neighbor, -X -Y neighbor reached through the -X one and +X -Y neighbor reached through the -Y one
+			const VectorRegisterInt HasUpLeft = VectorIntAnd(IsConnected(Bits, 0), IsConnected(VectorIntLoad(&Connections[DenseIndex - 1]), 1));
+			const VectorRegisterInt HasUpRight = VectorIntAnd(HasUp, IsConnected(VectorIntLoad(&Connections[DenseIndex - Stride]), 2));
+
+			VectorRegisterInt Distance = VectorIntLoad(&Distances[DenseIndex]);
+			Distance = ReduceDistance(Distance, HasUp, VectorIntLoad(&Distances[DenseIndex - Stride]), AxisCost);
+			Distance = ReduceDistance(Distance, HasUpLeft, VectorIntLoad(&Distances[DenseIndex - Stride - 1]), DiagonalCost);
+			Distance = ReduceDistance(Distance, HasUpRight, VectorIntLoad(&Distances[DenseIndex - Stride + 1]), DiagonalCost);
+			VectorIntStore(Distance, &Distances[DenseIndex]);
+		}
+
+		for (int Column = 1; Column <= AreaWidth; Column++)
+		{
+			const int DenseIndex = RowStart + Column;
+
+			if (Connections[DenseIndex] & (1 << 0))
+			{
+				Distances[DenseIndex] = FMath::Min(Distances[DenseIndex], Distances[DenseIndex - 1] + 2);
+			}
+		}
+	}
+
+	//Backward pass, same logic as above with the +Y row and the +X neighbor
+	for (int Row = AreaDepth; Row >= 1; Row--)
+	{
+		const int RowStart = Row * Stride;
+
+		for (int Column = 1; Column <= AreaWidth; Column += 4)
+		{
+			const int DenseIndex = RowStart + Column;
+
+			const VectorRegisterInt Bits = VectorIntLoad(&Connections[DenseIndex]);
+			const VectorRegisterInt HasDown = IsConnected(Bits, 3);
+
+			//+Y neighbor, +X +Y neighbor reached through the +X one and -X +Y neighbor reached through the +Y one
+			const VectorRegisterInt HasDownRight = VectorIntAnd(IsConnected(Bits, 2), IsConnected(VectorIntLoad(&Connections[DenseIndex + 1]), 3));
+			const VectorRegisterInt HasDownLeft = VectorIntAnd(HasDown, IsConnected(VectorIntLoad(&Connections[DenseIndex + Stride]), 0));
+
+			VectorRegisterInt Distance = VectorIntLoad(&Distances[DenseIndex]);
+			Distance = ReduceDistance(Distance, HasDown, VectorIntLoad(&Distances[DenseIndex + Stride]), AxisCost);
+			Distance = ReduceDistance(Distance, HasDownRight, VectorIntLoad(&Distances[DenseIndex + Stride + 1]), DiagonalCost);
+			Distance = ReduceDistance(Distance, HasDownLeft, VectorIntLoad(&Distances[DenseIndex + Stride - 1]), DiagonalCost);
+			VectorIntStore(Distance, &Distances[DenseIndex]);
+		}
+
+		for (int Column = AreaWidth; Column >= 1; Column--)
+		{
+			const int DenseIndex = RowStart + Column;
+
+			if (Connections[DenseIndex] & (1 << 2))
+			{
+				Distances[DenseIndex] = FMath::Min(Distances[DenseIndex], Distances[DenseIndex + 1] + 2);
+			}
+		}
+	}
+
+	//Copy the distances back to the spans
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
+	{
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; ++WidthIndex)
+		{
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+			if (Cell.Count == 0)
+			{
+				continue;
+			}
+
+			const int Distance = Distances[(DepthIndex - OccupiedDepthMin + 1) * Stride + WidthIndex - AreaWidthMin + 1];
+			BorderDistances[Cell.Index] = Distance;
 
-					CurrentSpan->DistanceToBorder = MinDistance + 2;
-					
-					//At this point of the algorithm, after having established all the value of the single spans
-				    //Find the min and max distance from the border
-					CalculateBorderDistanceMinMax(CurrentSpan->DistanceToBorder);
+			if (Distance != 0)
+			{
+				CalculateBorderDistanceMinMax(Distance);
+			}
+		}
+	}
+}
+
+void UOpenHeightfield::BlurDistanceField()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlurDistanceField);
+
+	//Every span reads the distances of the previous iteration and writes only its own value in the second buffer, so the rows are processed in parallel
+	TArray<uint16> BlurredDistances;
+	BlurredDistances.SetNumUninitialized(BorderDistances.Num());
+
+	ParallelFor(FMath::Max(OccupiedDepthMax - OccupiedDepthMin + 1, 0), [&](int32 It)
+	{
+		BlurRowDistances(OccupiedDepthMin + It, BlurredDistances);
+	});
+
+	Swap(BorderDistances, BlurredDistances);
+}
+
+void UOpenHeightfield::BlurRowDistances(const int DepthIndex, TArray<uint16>& BlurredDistances) const
+{
+	//The spans close to the border keep their distance, so the blur doesn't move the border of the regions
+	const int Threshold = SmoothingThreshold * 2;
+
+	for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
+	{
+		const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+		for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
+		{
+			const int CurrentDistance = BorderDistances[SpanIndex];
 
-					CurrentSpan = CurrentSpan->nextSpan;
-				} while (CurrentSpan);
+			if (CurrentDistance <= Threshold)
+			{
+				BlurredDistances[SpanIndex] = CurrentDistance;
+				continue;
 			}
+
+			//Average of the 3x3 block around the span, the missing neighbors are replaced by the span itself
+			int Distance = CurrentDistance;
+
+			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+			{
+				const int AxisSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+
+				if (AxisSpan == NULL_OPEN_SPAN)
+				{
+					Distance += CurrentDistance * 2;
+					continue;
+				}
+
+				Distance += BorderDistances[AxisSpan];
+
+				const int DiagonalSpan = GetDiagonalNeighbor(AxisSpan, NeighborDir);
+				Distance += DiagonalSpan != NULL_OPEN_SPAN ? BorderDistances[DiagonalSpan] : CurrentDistance;
+			}
+
+			BlurredDistances[SpanIndex] = (Distance + 5) / 9;
 		}
 	}
 }
@@ -333,237 +671,465 @@ void UOpenHeightfield::CalculateBorderDistanceMinMax(const int DistanceToBorder)
 void UOpenHeightfield::GenerateRegions()
 {
 	int MinDist = TraversableAreaBorderSize + MinBorderDistance;
-	int CurrentDist = MaxBorderDistance;
 
 	//TODO - Check what is this magic iteration number
 	int ExpandIterations = 4 + (TraversableAreaBorderSize * 2);
-	
+
 	//0 is the NULL_REGION, therefore the count starts from 1
 	int NextRegionID = 1;
 
-	TArray<UOpenSpan*> FloodedSpans;
-	TArray<UOpenSpan*> WorkingStack;
+	//Distance considered at every level of the flooding (water level in term of watershed algorithm), decreased by 2 at every level
+	TArray<int> LevelDistances;
+
+	for (int CurrentDist = MaxBorderDistance; CurrentDist > MinDist; CurrentDist = FMath::Max(CurrentDist - 2, MinBorderDistance))
+	{
+		LevelDistances.Add(CurrentDist);
+	}
+
+	const int LevelCount = LevelDistances.Num();
+
+	//Sort the spans by the first level they are flooded at, so that every level only looks at its own spans
+	//The spans under MinDist are not flooded, the ones flooded only by the final expansion are stored in the last bucket
+	TArray<int> LevelSpans;
+	TArray<int> LevelStarts;
+	LevelStarts.SetNumZeroed(LevelCount + 2);
+
+	auto GetSpanLevel = [&](const int SpanIndex)
+	{
+		const int Distance = BorderDistances[SpanIndex];
+
+		if (Distance < MinDist)
+		{
+			return INDEX_NONE;
+		}
+
+		return FMath::Min(FMath::DivideAndRoundUp(FMath::Max(MaxBorderDistance - Distance, 0), 2), LevelCount);
+	};
+
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
+	{
+		const int Level = GetSpanLevel(SpanIndex);
+
+		if (Level != INDEX_NONE)
+		{
+			LevelStarts[Level + 1]++;
+		}
+	}
+
+	for (int Level = 0; Level <= LevelCount; Level++)
+	{
+		LevelStarts[Level + 1] += LevelStarts[Level];
+	}
+
+	LevelSpans.SetNumUninitialized(LevelStarts[LevelCount + 1]);
+
+	{
+		TArray<int> LevelEnds(LevelStarts);
+
+		for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
+		{
+			const int Level = GetSpanLevel(SpanIndex);
+
+			if (Level != INDEX_NONE)
+			{
+				LevelSpans[LevelEnds[Level]++] = SpanIndex;
+			}
+		}
+	}
+
+	//Unassigned spans with a distance from border greater than the current level, the spans of the previous levels that couldn't be assigned are kept
+	TArray<int> FloodedSpans;
+
+	auto AddLevelSpans = [&](const int Level)
+	{
+		FloodedSpans.RemoveAll([&](const int SpanIndex) { return RegionIDs[SpanIndex] != NULL_REGION; });
+
+		for (int It = LevelStarts[Level]; It < LevelStarts[Level + 1]; It++)
+		{
+			if (RegionIDs[LevelSpans[It]] == NULL_REGION)
+			{
+				FloodedSpans.Add(LevelSpans[It]);
+			}
+		}
+	};
 
-	while (CurrentDist > MinDist)
+	for (int Level = 0; Level < LevelCount; Level++)
 	{
-		for (auto& Span : Spans)
-		{
-			UOpenSpan* CurrentSpan = Span.Value;
-
-			do
-			{
-				//If a span is unassigned and its distance from border is greater than the current distance considered
-				//Add it to the array of the span to process
-				if (CurrentSpan->RegionID == NULL_REGION && CurrentSpan->DistanceToBorder >= CurrentDist)
-				{
-					FloodedSpans.Add(CurrentSpan);
-				}
+		const int CurrentDist = LevelDistances[Level];
 
-				CurrentSpan = CurrentSpan->nextSpan;
-			} 
-			while (CurrentSpan);
-		}
+		AddLevelSpans(Level);
 
 		//After a region has been created, iterate through the current spans to flood, try to check if they can be added to the new region
 		if (NextRegionID > 1)
 		{
 			if (CurrentDist > 0)
 			{
-				ExpandRegions(FloodedSpans, ExpandIterations);
+				ExpandRegions(FloodedSpans, CurrentDist, ExpandIterations);
 			}
 			else
 			{
-				ExpandRegions(FloodedSpans, -1);
+				ExpandRegions(FloodedSpans, CurrentDist, -1);
 			}
 		}
 
 		//Try creating a new region for all the spans that couldn't be added to existing regions or if it's the first iteration of the loop
-		for (UOpenSpan*& CurrentSpan : FloodedSpans)
+		for (int SpanIndex : FloodedSpans)
 		{
-			if (!CurrentSpan || CurrentSpan->RegionID != 0)
+			if (RegionIDs[SpanIndex] != NULL_REGION)
 			{
 				continue;
 			}
 
 			int FillTo = FMath::Max(CurrentDist - 2, MinDist);
-			FloodNewRegion(CurrentSpan, FillTo, NextRegionID);
+			FloodNewRegion(SpanIndex, FillTo, NextRegionID);
 		}
-
-		//Decrease the distance considered (water level in term of watershed algorithm and repeat the loop)
-		CurrentDist = FMath::Max(CurrentDist - 2, MinBorderDistance);
 	}
 
-
-	FloodedSpans.Empty();
-	for (auto& Span : Spans)
-	{
-		UOpenSpan* CurrentSpan = Span.Value;
-
-		do
-		{
-			if (CurrentSpan->DistanceToBorder >= MinDist && CurrentSpan->RegionID == NULL_REGION)
-			{
-				FloodedSpans.Add(CurrentSpan);
-			}
-
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
-	}
+	AddLevelSpans(LevelCount);
 
 	if (MinDist > 0)
 	{
-		ExpandRegions(FloodedSpans, ExpandIterations * 8);
+		ExpandRegions(FloodedSpans, MinDist, ExpandIterations * 8);
 	}
 	else
 	{
-		ExpandRegions(FloodedSpans, -1);
+		ExpandRegions(FloodedSpans, MinDist, -1);
 	}
 
 	RegionCount = NextRegionID;
 }
 
-void UOpenHeightfield::ExpandRegions(TArray<UOpenSpan*>& FloodedSpans, const int MaxIterations)
+void UOpenHeightfield::ExpandRegions(const TArray<int>& FloodedSpans, const int FloodDistance, const int MaxIterations)
 {
-	int TotalFloodedSpans = FloodedSpans.Num();
+	//The first iteration considers all the flooded spans, the next ones only the flooded spans that can be affected by the spans added in the previous iteration
+	TArray<int> Frontier;
+	TArray<int> NextFrontier;
 
-	//If there are no spans to flood, return
-	if (TotalFloodedSpans == 0)
+	for (int SpanIndex : FloodedSpans)
 	{
-		return;
+		if (RegionIDs[SpanIndex] == NULL_REGION)
+		{
+			Frontier.Add(SpanIndex);
+		}
 	}
 
+	//Region and distance to the region core found for every span of the frontier, written in parallel and applied once the iteration is over
+	TArray<int> ExpansionRegions;
+	TArray<int> ExpansionCoreDistances;
+
+	//A span is flooded if it is not assigned and has a distance from border greater than the one passed in
+	auto AddFloodedSpan = [&](const int SpanIndex)
+	{
+		if (SpanIndex != NULL_OPEN_SPAN && RegionIDs[SpanIndex] == NULL_REGION && BorderDistances[SpanIndex] >= FloodDistance)
+		{
+			NextFrontier.Add(SpanIndex);
+		}
+	};
+
 	int IterCount = 0;
 
-	while (true)
+	//Exit the loop once no span has been added during the last iteration
+	while (Frontier.Num() > 0)
 	{
-		int Skipped = 0;
+		ExpansionRegions.SetNumUninitialized(Frontier.Num(), false);
+		ExpansionCoreDistances.SetNumUninitialized(Frontier.Num(), false);
 
-		for (UOpenSpan*& Span : FloodedSpans)
+		//The spans only read the regions assigned by the previous iterations, so the result doesn't depend on the order or the number of threads
+		const int ChunkCount = FMath::DivideAndRoundUp(Frontier.Num(), REGION_EXPANSION_CHUNK_SIZE);
+
+		ParallelFor(ChunkCount, [&](int32 Chunk)
 		{
-			//The current span considered already possess a non-null region assigned to it, it can be skipped
-			if (Span->RegionID != NULL_REGION)
+			const int ChunkEnd = FMath::Min((Chunk + 1) * REGION_EXPANSION_CHUNK_SIZE, Frontier.Num());
+
+			for (int It = Chunk * REGION_EXPANSION_CHUNK_SIZE; It < ChunkEnd; It++)
 			{
-				Skipped++;
-				continue;
+				//The span can be in the frontier more than once, the result is the same for all the copies
+				ExpansionRegions[It] = RegionIDs[Frontier[It]] == NULL_REGION ? GetExpansionRegion(Frontier[It], ExpansionCoreDistances[It]) : NULL_REGION;
+			}
+		});
+
+		for (int It = 0; It < Frontier.Num(); It++)
+		{
+			//An appropriate region has been found for the current span, add it to it, otherwise skip it
+			//Only the first copy of a span is applied, so that its neighbors are added to the next frontier once
+			if (ExpansionRegions[It] != NULL_REGION && RegionIDs[Frontier[It]] == NULL_REGION)
+			{
+				RegionIDs[Frontier[It]] = ExpansionRegions[It];
+				RegionCoreDistances[Frontier[It]] = ExpansionCoreDistances[It];
 			}
+			else
+			{
+				ExpansionRegions[It] = NULL_REGION;
+			}
+		}
 
-			int SpanRegion = NULL_REGION;
-			int RegionCenterDistance = INT_MAX;
+		//The next frontier is built in order once all the spans are assigned, so it only contains the spans that are still flooded
+		for (int It = 0; It < Frontier.Num(); It++)
+		{
+			const int SpanIndex = Frontier[It];
+			const int SpanRegion = ExpansionRegions[It];
+
+			if (SpanRegion == NULL_REGION)
+			{
+				continue;
+			}
 
-			//Loop through the neighbor 
 			for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
 			{
-				UOpenSpan* NeighborSpan = Span->GetAxisNeighbor(NeighborDir);
-				if (!NeighborSpan)
+				const int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+
+				if (NeighborSpan == NULL_OPEN_SPAN)
 				{
 					continue;
 				}
 
-				//Neighbor not assigned to null region
-				if (NeighborSpan->RegionID > NULL_REGION)
+				AddFloodedSpan(NeighborSpan);
+
+				//With the conservative expansion the span also increases the same region count of its neighbors, which can let their own neighbors join the region
+				if (UseConservativeExpansion && RegionIDs[NeighborSpan] == SpanRegion)
+				{
+					for (int NNeighborDir = 0; NNeighborDir < 4; NNeighborDir++)
+					{
+						AddFloodedSpan(GetAxisNeighbor(NeighborSpan, NNeighborDir));
+					}
+				}
+			}
+		}
+
+		Swap(Frontier, NextFrontier);
+		NextFrontier.Reset();
+
+		//Iteration limit reached, exit the loop
+		if (MaxIterations != -1)
+		{
+			IterCount++;
+			if (IterCount > MaxIterations)
+			{
+				break;
+			}
+		}
+	}
+}
+
+int UOpenHeightfield::GetExpansionRegion(const int SpanIndex, int& OutRegionCenterDistance) const
+{
+	int SpanRegion = NULL_REGION;
+	OutRegionCenterDistance = INT_MAX;
+
+	//Loop through the neighbor
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+	{
+		int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+		if (NeighborSpan == NULL_OPEN_SPAN)
+		{
+			continue;
+		}
+
+		//Neighbor not assigned to null region
+		if (RegionIDs[NeighborSpan] > NULL_REGION)
+		{
+			//Neighbor closer to region core than previously considered neighbors
+			if (RegionCoreDistances[NeighborSpan] + 2 < OutRegionCenterDistance)
+			{
+				int SameRegionCount = 0;
+				if (UseConservativeExpansion)
 				{
-					//Neighbor closer to region core than previously considered neighbors
-					if (NeighborSpan->DistanceToRegionCore + 2 < RegionCenterDistance)
+					//Check if his neighbor has at least two other neighbors in its region.
+				    //This makes sure that adding this span to this neighbor's region will not result in a single width line of voxels.
+					for (int NNeighborDir = 0; NNeighborDir < 4; NNeighborDir++)
 					{
-						int SameRegionCount = 0;
-						if (UseConservativeExpansion)
+						int NNeighborSpan = GetAxisNeighbor(NeighborSpan, NNeighborDir);
+						if (NNeighborSpan == NULL_OPEN_SPAN)
 						{
-							//Check if his neighbor has at least two other neighbors in its region.
-						    //This makes sure that adding this span to this neighbor's region will not result in a single width line of voxels.
-							for (int NNeighborDir = 0; NNeighborDir < 4; NNeighborDir++)
-							{
-								UOpenSpan* NNeighborSpan = NeighborSpan->GetAxisNeighbor(NNeighborDir);
-								if (!NNeighborSpan)
-								{
-									continue;
-								}
-
-								if (NNeighborSpan->RegionID == NeighborSpan->RegionID)
-								{
-									SameRegionCount++;
-								}
-							}
+							continue;
 						}
 
-						//If the conservative expansion is turned off or the condition considered above is met
-						//Set the SpanRegion equal to the neighbor one and set the current distance to center as slightly further than this neighbor
-						if (!UseConservativeExpansion || SameRegionCount > 1)
+						if (RegionIDs[NNeighborSpan] == RegionIDs[NeighborSpan])
 						{
-							SpanRegion = NeighborSpan->RegionID;
-							RegionCenterDistance = NeighborSpan->DistanceToRegionCore + 2;
+							SameRegionCount++;
 						}
 					}
 				}
+
+				//If the conservative expansion is turned off or the condition considered above is met
+				//Set the SpanRegion equal to the neighbor one and set the current distance to center as slightly further than this neighbor
+				if (!UseConservativeExpansion || SameRegionCount > 1)
+				{
+					SpanRegion = RegionIDs[NeighborSpan];
+					OutRegionCenterDistance = RegionCoreDistances[NeighborSpan] + 2;
+				}
 			}
+		}
+	}
 
-			//An appropriate region has been found for the current span, add it to it, otherwise skip it
-			if (SpanRegion != NULL_REGION)
+	return SpanRegion;
+}
+
+void UOpenHeightfield::ErodeTraversableArea()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ErodeTraversableArea);
+
+	//The border spans have a distance of 0, all the other ones REGION_MAX_BORDER
+	FindBorderSpan();
+
+	//Every other span is at least 2 away from the border, none of them can be eroded
+	if (TraversableAreaBorderSize <= 2)
+	{
+		return;
+	}
+
+	//Same chamfer passes, with the same 2 and 3 weights, as the distance field of the watershed partitioning, without the blur
+	GenerateDistanceFieldScalar();
+}
+
+bool UOpenHeightfield::IsSpanEroded(const int SpanIndex) const
+{
+	return BorderDistances[SpanIndex] < TraversableAreaBorderSize;
+}
+
+void UOpenHeightfield::GenerateMonotoneRegions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MonotoneRegions);
+
+	//0 is the NULL_REGION, therefore the count starts from 1
+	int NextRegionID = 1;
+
+	//Number of spans of the current row connected to every region, only the regions of the previous row are set
+	TArray<int> PreviousRowCounts;
+	PreviousRowCounts.SetNumZeroed(NextRegionID);
+
+	//Sweeps of the current row, the first one is unused so that the sweep IDs can be stored in place of the region IDs
+	TArray<FRegionSweep> Sweeps;
+
+	for (int DepthIndex = OccupiedDepthMin; DepthIndex <= OccupiedDepthMax; DepthIndex++)
+	{
+		Sweeps.Reset();
+		Sweeps.AddDefaulted();
+
+		//The spans of the row store the ID of their sweep until the sweeps are assigned to a region
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
+		{
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
+
+			for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
+			{
+				//The eroded spans stay in the null region and split the sweeps
+				if (IsSpanEroded(SpanIndex))
+				{
+					RegionIDs[SpanIndex] = NULL_REGION;
+					continue;
+				}
+
+				//Continue the sweep of the -X neighbor, already processed, or start a new one
+				const int LeftSpan = GetAxisNeighbor(SpanIndex, 0);
+				const int SweepID = LeftSpan != NULL_OPEN_SPAN && !IsSpanEroded(LeftSpan) ? RegionIDs[LeftSpan] : Sweeps.AddDefaulted();
+
+				//The -Y neighbor belongs to the previous row, so its region is already assigned
+				const int UpSpan = GetAxisNeighbor(SpanIndex, 1);
+
+				if (UpSpan != NULL_OPEN_SPAN && RegionIDs[UpSpan] != NULL_REGION)
+				{
+					FRegionSweep& Sweep = Sweeps[SweepID];
+					const int NeighborRegionID = RegionIDs[UpSpan];
+
+					if (Sweep.NeighborRegionID == NULL_REGION || Sweep.NeighborRegionID == NeighborRegionID)
+					{
+						Sweep.NeighborRegionID = NeighborRegionID;
+						Sweep.NeighborCount++;
+						PreviousRowCounts[NeighborRegionID]++;
+					}
+					else
+					{
+						Sweep.NeighborRegionID = INDEX_NONE;
+					}
+				}
+
+				RegionIDs[SpanIndex] = SweepID;
+			}
+		}
+
+		//A sweep continues the region of the previous row only if all the spans of the row connected to that region belong to the sweep
+		for (int SweepID = 1; SweepID < Sweeps.Num(); SweepID++)
+		{
+			FRegionSweep& Sweep = Sweeps[SweepID];
+
+			if (Sweep.NeighborRegionID > NULL_REGION && PreviousRowCounts[Sweep.NeighborRegionID] == Sweep.NeighborCount)
 			{
-				Span->RegionID = SpanRegion;
-				Span->DistanceToRegionCore = RegionCenterDistance;
+				Sweep.RegionID = Sweep.NeighborRegionID;
 			}
 			else
 			{
-				Skipped++;
+				Sweep.RegionID = NextRegionID++;
+				PreviousRowCounts.Add(0);
 			}
 		}
 
-		//All spans were already processed or skipped, exit the iteration loop
-		if (Skipped == TotalFloodedSpans)
+		//Replace the sweep IDs with the region ones and reset the counts of the previous row
+		for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
 		{
-			break;
-		}
+			const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
 
-		//Iteration limit reached, exit the loop
-		if (MaxIterations != -1)
-		{
-			IterCount++;
-			if (IterCount > MaxIterations)
+			for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
 			{
-				break;
+				if (RegionIDs[SpanIndex] == NULL_REGION)
+				{
+					continue;
+				}
+
+				RegionIDs[SpanIndex] = Sweeps[RegionIDs[SpanIndex]].RegionID;
+
+				const int UpSpan = GetAxisNeighbor(SpanIndex, 1);
+
+				if (UpSpan != NULL_OPEN_SPAN && RegionIDs[UpSpan] != NULL_REGION)
+				{
+					PreviousRowCounts[RegionIDs[UpSpan]] = 0;
+				}
 			}
 		}
 	}
+
+	RegionCount = NextRegionID;
 }
 
-void UOpenHeightfield::FloodNewRegion(UOpenSpan* RootSpan, const int FillToDistance, int& RegionID)
+void UOpenHeightfield::FloodNewRegion(const int RootSpan, const int FillToDistance, int& RegionID)
 {
 	int RegionSize = 0;
 
-	//Create a temporary span container and add the span passed in to it
-	TArray<UOpenSpan*> TempSpanStack;
+	//Add the span passed in to the work queue, the queue is emptied without releasing its memory so that it can be reused by every call
+	//The spans are read from the head index instead of being removed from the front of the array
+	FloodQueue.Reset();
+	int QueueHead = 0;
 
-	RootSpan->RegionID = RegionID;
-	RootSpan->DistanceToRegionCore = 0;
-	TempSpanStack.Add(RootSpan);
+	RegionIDs[RootSpan] = RegionID;
+	RegionCoreDistances[RootSpan] = 0;
+	FloodQueue.Add(RootSpan);
 
-	while (TempSpanStack.Num() > 0)
+	while (QueueHead < FloodQueue.Num())
 	{
-		UOpenSpan* CurrentSpan = TempSpanStack[0];
+		int CurrentSpan = FloodQueue[QueueHead++];
 
 		bool IsOnRegionBorder = false;
 
 		//Neighbor search, both axis and diagonal
 		for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
 		{
-			UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
-			if (!NeighborSpan)
+			int NeighborSpan = GetAxisNeighbor(CurrentSpan, NeighborDir);
+			if (NeighborSpan == NULL_OPEN_SPAN)
 			{
 				continue;
 			}
 
 			//Current span border the null region or another region, exit the loop
-			if (NeighborSpan->RegionID != NULL_REGION && NeighborSpan->RegionID != RegionID)
+			if (RegionIDs[NeighborSpan] != NULL_REGION && RegionIDs[NeighborSpan] != RegionID)
 			{
 				IsOnRegionBorder = true;
 				break;
 			}
 
 			//Same as above + the check on the diagonal neighbor validity
-			NeighborSpan = NeighborSpan->GetDiagonalNeighbor(NeighborDir);
+			NeighborSpan = GetDiagonalNeighbor(NeighborSpan, NeighborDir);
 
-			if (NeighborSpan && NeighborSpan->RegionID != NULL_REGION && NeighborSpan->RegionID != RegionID)
+			if (NeighborSpan != NULL_OPEN_SPAN && RegionIDs[NeighborSpan] != NULL_REGION && RegionIDs[NeighborSpan] != RegionID)
 			{
 				IsOnRegionBorder = true;
 				break;
@@ -571,11 +1137,9 @@ void UOpenHeightfield::FloodNewRegion(UOpenSpan* RootSpan, const int FillToDista
 		}
 
 		//If the current span border the null or another region, it can't be part of the new one
-		//Remove the span considered from the array
 		if (IsOnRegionBorder)
 		{
-			CurrentSpan->RegionID = NULL_REGION;
-			TempSpanStack.RemoveAt(0);
+			RegionIDs[CurrentSpan] = NULL_REGION;
 			continue;
 		}
 
@@ -585,19 +1149,16 @@ void UOpenHeightfield::FloodNewRegion(UOpenSpan* RootSpan, const int FillToDista
 
 		for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
 		{
-			UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(NeighborDir);
+			int NeighborSpan = GetAxisNeighbor(CurrentSpan, NeighborDir);
 
 			//Check again the neighbor and if the span is valid, it is not assigned and has a distance greater than the one passed in
-			if (NeighborSpan && NeighborSpan->DistanceToBorder >= FillToDistance && NeighborSpan->RegionID == 0)
+			if (NeighborSpan != NULL_OPEN_SPAN && BorderDistances[NeighborSpan] >= FillToDistance && RegionIDs[NeighborSpan] == NULL_REGION)
 			{
-				NeighborSpan->RegionID = RegionID;
-				NeighborSpan->DistanceToRegionCore = 0;
-				TempSpanStack.Add(NeighborSpan);
+				RegionIDs[NeighborSpan] = RegionID;
+				RegionCoreDistances[NeighborSpan] = 0;
+				FloodQueue.Add(NeighborSpan);
 			}
 		}
-
-		//Remove the span considered from the array and repeat the loop
-		TempSpanStack.RemoveAt(0);
 	}
 
 	//Reach this point, if the region size is greater than 0, the new region has been created
@@ -618,108 +1179,220 @@ void UOpenHeightfield::HandleSmallRegions()
 		return;
 	}
 
-	//Create an array of empty region object based on the current total of region known
-	TArray<URegion*> Regions;
+	TArray<FRegion> Regions;
+	FRegionIDTable IDTable;
+	CreateRegions(Regions, IDTable);
+
+	RemoveSmallUnconnectedRegions(Regions, IDTable);
+	MergeRegions(Regions, IDTable, MinMergeRegionSize);
+	RemapRegionAndSpansID(IDTable);
+}
+
+void UOpenHeightfield::MergeRegionLayers()
+{
+	//Only null region found, no need to execute the code below
+	if (RegionCount < 2)
+	{
+		return;
+	}
+
+	TArray<FRegion> Regions;
+	FRegionIDTable IDTable;
+	CreateRegions(Regions, IDTable);
+
+	//Merge the regions regardless of their size, the merging stops once the remaining neighbors overlap or connect in more than one point
+	//The last condition prevents the merged regions from wrapping around other regions
+	MergeRegions(Regions, IDTable, INT_MAX);
+	RemapRegionAndSpansID(IDTable);
+}
+
+void UOpenHeightfield::CreateRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable)
+{
+	//Create an array of empty regions based on the current total of region known
+	Regions.SetNum(RegionCount);
+
 	for (int Iter = 0; Iter < RegionCount; Iter++)
 	{
-		URegion* NewRegion = NewObject<URegion>(URegion::StaticClass());
-		NewRegion->ID = Iter;
-		Regions.Add(NewRegion);
+		Regions[Iter].ID = Iter;
 	}
 
+	IDTable.Init(RegionCount);
 	GatherRegionsData(Regions);
-	RemoveSmallUnconnectedRegions(Regions);
-	MergeRegions(Regions);
-	RemapRegionAndSpansID(Regions);
 }
 
-void UOpenHeightfield::GatherRegionsData(TArray<URegion*>& Regions)
+void UOpenHeightfield::GatherRegionsData(TArray<FRegion>& Regions)
 {
-	//Iterate through the spans
-	for (auto& Span : Spans)
+	SCOPE_CYCLE_COUNTER(STAT_GatherRegionsData);
+
+	//Data of a region found inside a band of rows
+	struct FRegionBandEntry
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		int RegionID;
+		int SpanCount;
 
-		do
-		{
-			//If a spans belongs to the null region, skip it
-			if (CurrentSpan->RegionID == NULL_REGION)
-			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
-			}
+		//First span of the region on the region edge, NULL_OPEN_SPAN if the band has none
+		int EdgeSpan;
+	};
+
+	//Data found by a band of rows, the bands are swept in parallel and then combined in order
+	//Only the regions present in the band get an entry, so the size of the band data doesn't depend on the total region count
+	struct FRegionBandData
+	{
+		TArray<FRegionBandEntry> Entries;
+
+		//Index of the entry of every region found in the band
+		TMap<int, int> EntryIndices;
+
+		//Pairs of regions overlapping in a column, the lower region in the high 32 bits
+		TArray<uint64> Overlaps;
+	};
 
-			//Increase the current span count of the region the span belongs to
-			URegion* Region = Regions[CurrentSpan->RegionID];
-			Region->SpanCount++;
+	const int RowCount = FMath::Max(OccupiedDepthMax - OccupiedDepthMin + 1, 0);
+	const int BandCount = FMath::DivideAndRoundUp(RowCount, REGION_GATHER_BAND_ROWS);
 
-			UOpenSpan* NextSpan = CurrentSpan->nextSpan;
+	TArray<FRegionBandData> Bands;
+	Bands.SetNum(BandCount);
 
-			while (NextSpan)
+	ParallelFor(BandCount, [&](int32 BandIndex)
+	{
+		FRegionBandData& Band = Bands[BandIndex];
+
+		//The adjacent spans mostly belong to the same region, so the last entry found is checked before the map
+		int LastRegionID = NULL_REGION;
+		int LastEntryIndex = INDEX_NONE;
+
+		const int DepthStart = OccupiedDepthMin + BandIndex * REGION_GATHER_BAND_ROWS;
+		const int DepthEnd = FMath::Min(DepthStart + REGION_GATHER_BAND_ROWS - 1, OccupiedDepthMax);
+
+		for (int DepthIndex = DepthStart; DepthIndex <= DepthEnd; DepthIndex++)
+		{
+			for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
 			{
-				//If a spans belongs to the null region, skip it
-				if (NextSpan->RegionID == NULL_REGION)
-				{
-					NextSpan = NextSpan->nextSpan;
-					continue;
-				}
+				const FOpenHeightfieldCell& Cell = Cells[DepthIndex * Width + WidthIndex];
 
-				//If a undetected region is found above the current one, add it to the overlapping array
-				if (!Region->OverlappingRegions.Contains(NextSpan->RegionID))
+				for (int SpanIndex = Cell.Index; SpanIndex < int(Cell.Index + Cell.Count); SpanIndex++)
 				{
-					Region->OverlappingRegions.Add(NextSpan->RegionID);
-				}
+					const int RegionID = RegionIDs[SpanIndex];
 
-				NextSpan = NextSpan->nextSpan;
-			}
+					//If a spans belongs to the null region, skip it
+					if (RegionID == NULL_REGION)
+					{
+						continue;
+					}
 
-			//The connection for this region has been already found, skip the rest of the code
-			//To understand why this condirtion is applied, check the method below FindRegionConnections
-			if (Region->Connections.Num() > 0)
-			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
+					if (RegionID != LastRegionID)
+					{
+						int* EntryIndex = Band.EntryIndices.Find(RegionID);
+
+						if (EntryIndex)
+						{
+							LastEntryIndex = *EntryIndex;
+						}
+						else
+						{
+							LastEntryIndex = Band.Entries.Add({ RegionID, 0, NULL_OPEN_SPAN });
+							Band.EntryIndices.Add(RegionID, LastEntryIndex);
+						}
+
+						LastRegionID = RegionID;
+					}
+
+					FRegionBandEntry& Entry = Band.Entries[LastEntryIndex];
+
+					//Increase the current span count of the region the span belongs to
+					Entry.SpanCount++;
+
+					//The spans above the current one are the following ones in the same column
+					for (int NextSpan = SpanIndex + 1; NextSpan < int(Cell.Index + Cell.Count); NextSpan++)
+					{
+						if (RegionIDs[NextSpan] != NULL_REGION)
+						{
+							Band.Overlaps.Add((uint64(RegionID) << 32) | uint64(RegionIDs[NextSpan]));
+						}
+					}
+
+					//The connections of a region are found starting from its first span on the region edge
+					if (Entry.EdgeSpan == NULL_OPEN_SPAN && GetRegionEdgeDirection(SpanIndex) != -1)
+					{
+						Entry.EdgeSpan = SpanIndex;
+					}
+				}
 			}
+		}
+
+		//Keep every pair once, the pairs are merged with the ones of the other bands later on
+		Band.Overlaps.Sort();
+		Band.Overlaps.SetNum(Algo::Unique(Band.Overlaps), false);
+	});
+
+	//The bands are combined in order, so the first edge span of every region is the same one found by a sequential sweep
+	TArray<int> EdgeSpans;
+	EdgeSpans.Init(NULL_OPEN_SPAN, RegionCount);
+
+	TArray<uint64> Overlaps;
+
+	for (const FRegionBandData& Band : Bands)
+	{
+		for (const FRegionBandEntry& Entry : Band.Entries)
+		{
+			Regions[Entry.RegionID].SpanCount += Entry.SpanCount;
 
-			//If the span is on the region edge
-			//Get the direction of the edge and proceeed to find all the region connections
-			int EdgeDirection = CurrentSpan->GetRegionEdgeDirection();
-			if (EdgeDirection != -1)
+			if (EdgeSpans[Entry.RegionID] == NULL_OPEN_SPAN)
 			{
-				FindRegionConnections(CurrentSpan, EdgeDirection, Region->Connections);
+				EdgeSpans[Entry.RegionID] = Entry.EdgeSpan;
 			}
+		}
+
+		Overlaps.Append(Band.Overlaps);
+	}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+	//Once sorted, the overlapping regions of every region are added in ascending order without duplicates
+	Overlaps.Sort();
+	Overlaps.SetNum(Algo::Unique(Overlaps), false);
+
+	for (uint64 Overlap : Overlaps)
+	{
+		Regions[int(Overlap >> 32)].OverlappingRegions.Add(int(Overlap & 0xFFFFFFFF));
 	}
+
+	//Every region walks its own edge and only writes its own connections, so the regions are processed in parallel
+	ParallelFor(RegionCount, [&](int32 RegionID)
+	{
+		const int EdgeSpan = EdgeSpans[RegionID];
+
+		if (RegionID != NULL_REGION && EdgeSpan != NULL_OPEN_SPAN)
+		{
+			FindRegionConnections(EdgeSpan, GetRegionEdgeDirection(EdgeSpan), Regions[RegionID].Connections, Regions[RegionID].SpanCount * 4);
+		}
+	});
 }
 
-void UOpenHeightfield::RemoveSmallUnconnectedRegions(TArray<URegion*>& Regions)
+void UOpenHeightfield::RemoveSmallUnconnectedRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable)
 {
 	for (int RegionID = 1; RegionID < RegionCount; RegionID++)
 	{
-		URegion* Region = Regions[RegionID];
+		FRegion& Region = Regions[RegionID];
 
 		//Skip empty regions
-		if (Region->SpanCount == 0)
+		if (Region.SpanCount == 0)
 		{
 			continue;
 		}
 
 		//If a region is only connected to the null one, check its number of spans
 		//If it is lower than the minimum amount specified, make the region a null region
-		if (Region->Connections.Num() == 1 && Region->Connections[NULL_REGION] == NULL_REGION)
+		if (Region.Connections.Num() == 1 && Region.Connections[NULL_REGION] == NULL_REGION)
 		{
-			if (Region->SpanCount < MinUnconnectedRegionSize)
+			if (Region.SpanCount < MinUnconnectedRegionSize)
 			{
-				Region->ResetID(0);
+				IDTable.Replace(RegionID, NULL_REGION);
+				Region.Reset();
 			}
 		}
 	}
 }
 
-void UOpenHeightfield::MergeRegions(TArray<URegion*>& Regions)
+void UOpenHeightfield::MergeRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable, const int MaxMergeSize)
 {
 	int MergeCount;
 
@@ -727,128 +1400,90 @@ void UOpenHeightfield::MergeRegions(TArray<URegion*>& Regions)
 	{
 		MergeCount = 0;
 
-		for (URegion* Region : Regions)
+		for (FRegion& Region : Regions)
 		{
-			//Skip null, empty and greater than minimum amount specified regions
-			if (Region->ID == NULL_REGION || Region->SpanCount == 0 || Region->SpanCount > MinMergeRegionSize)
+			//Skip null, empty (merged and removed ones included) and greater than minimum amount specified regions
+			if (Region.ID == NULL_REGION || Region.SpanCount == 0 || Region.SpanCount > MaxMergeSize)
 			{
 				continue;
 			}
 
-			URegion* TargetMergeRegion = nullptr;
+			//The connections still contain the IDs of the regions merged since they were gathered
+			Region.ResolveRegionIDs(IDTable);
+
+			FRegion* TargetMergeRegion = nullptr;
 			int SmallestSizeFound = INT_MAX;
 
 			//Search for the smallest neighbor region to the one considered
-			for (int RegionID : Region->Connections)
+			for (int RegionID : Region.Connections)
 			{
 				//Skip null regions
-				if (RegionID == NULL_REGION || RegionID == Region->ID)
+				if (RegionID == NULL_REGION || RegionID == Region.ID)
 				{
 					continue;
 				}
 
 				//If the region found is the smallest found, set it as target for the merging
-				URegion* RegionN = Regions[RegionID];
-				if (RegionN->SpanCount < SmallestSizeFound && Region->CanRegionBeMergedWith(RegionN))
+				FRegion& RegionN = Regions[RegionID];
+				RegionN.ResolveRegionIDs(IDTable);
+
+				if (RegionN.SpanCount < SmallestSizeFound && Region.CanRegionBeMergedWith(RegionN))
 				{
-					TargetMergeRegion = RegionN;
-					SmallestSizeFound = RegionN->SpanCount;
+					TargetMergeRegion = &RegionN;
+					SmallestSizeFound = RegionN.SpanCount;
 				}
 			}
 
 			//If a target is found, try the merge
-			if (TargetMergeRegion && Region->PerformRegionMergingIn(TargetMergeRegion))
+			if (TargetMergeRegion && Region.PerformRegionMergingIn(*TargetMergeRegion))
 			{
 				// A successful merge took place.
-				// Discard the old region
-				int OldRegionID = Region->ID;
-				Region->ResetID(TargetMergeRegion->ID);
-
-				//And replace it with the region it was merged into
-				for (URegion* R : Regions)
-				{
-					//Skip null region as usual
-					if (R->ID == NULL_REGION)
-					{
-						continue;
-					}
-
-					//Repoint the ID of the other regions to the new one
-					if (R->ID == OldRegionID)
-					{
-						R->ID = TargetMergeRegion->ID;
-					}
-					else
-					{
-						R->ReplaceNeighborRegionID(OldRegionID, TargetMergeRegion->ID);
-					}
-				}
+				// Point the old region (and the ones previously merged into it) to the target one and discard it
+				//The other regions replace the old ID the next time their IDs are resolved
+				IDTable.Replace(Region.ID, TargetMergeRegion->ID);
+				Region.Reset();
 				MergeCount++;
 			}
 		}
 	} while (MergeCount > 0);
 }
 
-void UOpenHeightfield::RemapRegionAndSpansID(TArray<URegion*>& Regions)
+void UOpenHeightfield::RemapRegionAndSpansID(FRegionIDTable& IDTable)
 {
-	for (URegion* Region : Regions)
-	{
-		//Set all non null region as suitable for region remapping
-		if (Region->ID > 0)
-		{
-			Region->IDRemapNeeded = true;
-		}
-	}
+	//New sequential ID of the regions left, assigned in the order of their lowest original ID
+	TArray<int> NewRegionIDs;
+	NewRegionIDs.Init(NULL_REGION, RegionCount);
 
 	int CurrentRegionID = 0;
-	for (URegion* Region : Regions)
+	for (int RegionID = 1; RegionID < RegionCount; RegionID++)
 	{
+		const int RootID = IDTable.Find(RegionID);
+
 		//Region null or already remapped
-		if (!Region->IDRemapNeeded)
+		if (RootID == NULL_REGION || NewRegionIDs[RootID] != NULL_REGION)
 		{
 			continue;
 		}
 
 		CurrentRegionID++;
-		int OldID = Region->ID;
-
-		// Search all regions for ones using the old region ID.
-		for (URegion* R : Regions)
-		{
-			// Re-assign the ones using the old ID to the new one
-			if (R->ID == OldID)
-			{
-				R->ID = CurrentRegionID;
-				R->IDRemapNeeded = false;
-			}
-		}
+		NewRegionIDs[RootID] = CurrentRegionID;
 	}
 
 	// Update the number of regions in the field
 	//The +1 is to take into consideration the null region
-	RegionCount = CurrentRegionID + 1;
-
-	//After having update the region ID, update the span ID
-	for (auto& Span : Spans)
-	{
-		UOpenSpan* CurrentSpan = Span.Value;
-
-		do
-		{
-			//If the span is a part of the null region skip it
-			if (CurrentSpan->RegionID == NULL_REGION)
-			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
-			}
-			else
-			{
-				// Re-map by getting the region object at the old index and assigning its current region id to the span.
-				CurrentSpan->RegionID = Regions[CurrentSpan->RegionID]->ID;
-			}
+	RegionCount = CurrentRegionID + 1;
+
+	//After having update the region ID, update the span ID
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
+	{
+		//If the span is a part of the null region skip it
+		if (RegionIDs[SpanIndex] == NULL_REGION)
+		{
+			continue;
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} while (CurrentSpan);
+		// Re-map by getting the region replacing the old one and assigning its new id to the span.
+		RegionIDs[SpanIndex] = NewRegionIDs[IDTable.Find(RegionIDs[SpanIndex])];
 	}
 }
 
@@ -858,37 +1493,39 @@ void UOpenHeightfield::SetMinRegionParameters()
 	MinMergeRegionSize = FMath::Max(0, MinMergeRegionSize);
 }
 
-void UOpenHeightfield::FindRegionConnections(UOpenSpan* Span, int NeighborDirection, TArray<int>& RegionConnection)
+
+void UOpenHeightfield::FindRegionConnections(const int SpanIndex, int NeighborDirection, TArray<int>& RegionConnection, const int MaxSteps) const
 {
-	UOpenSpan* CurrentSpan = Span;
+	int CurrentSpan = SpanIndex;
 
 	int LastEdgeRegionID = NULL_REGION;
 
 	int Direction = NeighborDirection;
 
 	//Get the neighbor span to the one considered by using the direction passed in and set the LastEdgeRegionID equal to it
-	UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(NeighborDirection);
-	if (NeighborSpan)
+	int NeighborSpan = GetAxisNeighbor(CurrentSpan, NeighborDirection);
+	if (NeighborSpan != NULL_OPEN_SPAN)
 	{
-		LastEdgeRegionID = NeighborSpan->RegionID;
+		LastEdgeRegionID = RegionIDs[NeighborSpan];
 	}
 
 	RegionConnection.Add(LastEdgeRegionID);
 
 	//Starting from the current span, loop through all the border spans of a region until the loop goes back to the beginning
+	//Every step moves to a different span and direction pair of the region, so the walk can't be longer than MaxSteps
 	int LoopCount = 0;
-	while (LoopCount < UINT16_MAX)
+	while (LoopCount < MaxSteps)
 	{
-		NeighborSpan = CurrentSpan->GetAxisNeighbor(Direction);
+		NeighborSpan = GetAxisNeighbor(CurrentSpan, Direction);
 		int CurrentEdgeRegion = NULL_REGION;
 
 		//The neighbor span considered is at the region edge
-		if (!NeighborSpan || NeighborSpan->RegionID != CurrentSpan->RegionID)
+		if (NeighborSpan == NULL_OPEN_SPAN || RegionIDs[NeighborSpan] != RegionIDs[CurrentSpan])
 		{
 			//If valid replace the current edge value with the one of the neighbor
-			if (NeighborSpan)
+			if (NeighborSpan != NULL_OPEN_SPAN)
 			{
-				CurrentEdgeRegion = NeighborSpan->RegionID;
+				CurrentEdgeRegion = RegionIDs[NeighborSpan];
 			}
 
 			//If the current edge is different from the last edge saved, then a new connections is found
@@ -900,18 +1537,18 @@ void UOpenHeightfield::FindRegionConnections(UOpenSpan* Span, int NeighborDirect
 			}
 
 			//Update the direction value, rotating through the neighbor of the span considered in clockwise direction
-			Direction = UOpenSpan::IncreaseNeighborDirection(Direction, 1);
+			Direction = FOpenSpan::IncreaseNeighborDirection(Direction, 1);
 		}
 		//The neighbor is in the same region as the current span 
 		//Update the current span value and rotate in counterclockwise direction
 		else
 		{
 			CurrentSpan = NeighborSpan;
-			Direction = UOpenSpan::DecreaseNeighborDirection(Direction, 1);
+			Direction = FOpenSpan::DecreaseNeighborDirection(Direction, 1);
 		}
 
 		//If the algorithm has returned to the original span, exit the loop
-		if (Span == CurrentSpan && NeighborDirection == Direction)
+		if (SpanIndex == CurrentSpan && NeighborDirection == Direction)
 		{
 			break;
 		}
@@ -931,159 +1568,495 @@ void UOpenHeightfield::CleanRegionBorders()
 {
 	int NextRegionID = RegionCount;
 
-	for (auto& Span : Spans)
+	TArray<bool> ProcessedSpans;
+	ProcessedSpans.Init(false, Spans.Num());
+
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		if (ProcessedSpans[SpanIndex])
+		{
+			continue;
+		}
+
+		ProcessedSpans[SpanIndex] = true;
+
+		int WorkingSpan;
+		int EdgeDirection = -1;
+
+		if (RegionIDs[SpanIndex] == NULL_REGION)
+		{
+			EdgeDirection = GetNonNullEdgeDirection(SpanIndex);
+			if (EdgeDirection == -1)
+			{
+				continue;
+			}
 
-		do
+			WorkingSpan = GetAxisNeighbor(SpanIndex, EdgeDirection);
+			EdgeDirection = FOpenSpan::IncreaseNeighborDirection(EdgeDirection, 2);
+		}
+		else if(!UseOnlyNullRegionSpans)
 		{
-			if (CurrentSpan->ProcessedForRegionFixing)
+			EdgeDirection = GetNullEdgeDirection(SpanIndex);
+			if (EdgeDirection == -1)
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
 				continue;
 			}
+			WorkingSpan = SpanIndex;
+		}
+		else
+		{
+			continue;
+		}
+
+		bool IsEncompassNullRegion = ProcessNullRegion(WorkingSpan, EdgeDirection, ProcessedSpans);
+
+		if (IsEncompassNullRegion)
+		{
+			PartialFloodRegion(WorkingSpan, EdgeDirection, NextRegionID);
+			NextRegionID++;
+		}
+	}
+
+	RegionCount = NextRegionID;
+
+	ReassignBorderSpan();
+}
+
+void UOpenHeightfield::GetNeighborRegionIDs(const int SpanIndex, TArray<int>& NeighborIDs) const
+{
+	//Initialize all the elements of the array as it has expected to return values (null) also for the possibly non existent neighbor
+	NeighborIDs.Init(NULL_REGION, 8);
+
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+	{
+		int AxisNeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+		if (AxisNeighborSpan != NULL_OPEN_SPAN)
+		{
+			NeighborIDs[NeighborDir] = RegionIDs[AxisNeighborSpan];
+			int DiagonalNeighborSpan = GetDiagonalNeighbor(AxisNeighborSpan, NeighborDir);
+			if (DiagonalNeighborSpan != NULL_OPEN_SPAN)
+			{
+				NeighborIDs[NeighborDir + 4] = RegionIDs[DiagonalNeighborSpan];
+			}
+		}
+	}
+}
+
+int UOpenHeightfield::SelectedRegionID(const int SpanIndex, int BorderDirection, int CornerDirection) const
+{
+	const int RegionID = RegionIDs[SpanIndex];
+
+	TArray<int> NeighborRegionIDs;
+	GetNeighborRegionIDs(SpanIndex, NeighborRegionIDs);
+
+	int NeighborID = NeighborRegionIDs[FOpenSpan::IncreaseNeighborDirection(BorderDirection, 2)];
+	if (NeighborID == RegionID || NeighborID == NULL_REGION)
+	{
+		return RegionID;
+	}
+
+	int PotentialRegion = NeighborID;
+
+	NeighborID = NeighborRegionIDs[FOpenSpan::IncreaseNeighborDirection(CornerDirection, 2)];
+	if (NeighborID == RegionID || NeighborID == NULL_REGION)
+	{
+		return RegionID;
+	}
+
+	int PotentialCount = 0;
+	int CurrentCount = 0;
+
+	for (int Iter = 0; Iter < 8; Iter++)
+	{
+		if (NeighborRegionIDs[Iter] == RegionID)
+		{
+			CurrentCount++;
+		}
+		else if (NeighborRegionIDs[Iter] == PotentialRegion)
+		{
+			PotentialCount++;
+		}
+	}
+
+	if (PotentialCount < CurrentCount)
+	{
+		return RegionID;
+	}
+
+	return PotentialRegion;
+}
+
+void UOpenHeightfield::PartialFloodRegion(const int SpanIndex, int BorderDirection, int NewRegionID)
+{
+	int AntiBorderDirection = FOpenSpan::IncreaseNeighborDirection(BorderDirection, 2);
+	int CurrRegionID = RegionIDs[SpanIndex];
+
+	RegionIDs[SpanIndex] = NewRegionID;
+	RegionCoreDistances[SpanIndex] = 0;
+
+	TArray<int> TempOpenSpans;
+	TArray<int> TempBorderDistances;
+	TempOpenSpans.Add(SpanIndex);
+	TempBorderDistances.Add(0);
 
-			CurrentSpan->ProcessedForRegionFixing = true;
+	while (TempOpenSpans.Num() > 0)
+	{
+		int TempSpan = TempOpenSpans.Pop();
+		int TempBorderDistance = TempBorderDistances.Pop();
 
-			UOpenSpan* WorkingSpan;
-			int EdgeDirection = -1;
+		for (int Index = 0; Index < 4; Index++)
+		{
+			int NeighborSpan = GetAxisNeighbor(TempSpan, Index);
+			if (NeighborSpan == NULL_OPEN_SPAN || RegionIDs[NeighborSpan] != CurrRegionID)
+			{
+				continue;
+			}
 
-			if (CurrentSpan->RegionID == NULL_REGION)
+			int NeighborDistance = TempBorderDistance;
+			if (Index == BorderDirection)
 			{
-				EdgeDirection = CurrentSpan->GetNonNullEdgeDirection();
-				if (EdgeDirection == -1)
+				if (TempBorderDistance == 0)
 				{
-					CurrentSpan = CurrentSpan->nextSpan;
 					continue;
 				}
 
-				WorkingSpan = CurrentSpan->GetAxisNeighbor(EdgeDirection);
-				EdgeDirection = CurrentSpan->IncreaseNeighborDirection(EdgeDirection, 2);
+				NeighborDistance--;
+			}
+			else if (Index == AntiBorderDirection)
+			{
+				NeighborDistance++;
+			}
+
+			RegionIDs[NeighborSpan] = NewRegionID;
+			RegionCoreDistances[NeighborSpan] = 0;
+
+			TempOpenSpans.Add(NeighborSpan);
+			TempBorderDistances.Add(NeighborDistance);
+		}
+	}
+}
+
+bool UOpenHeightfield::ProcessNullRegion(const int SpanIndex, int StartDirection, TArray<bool>& ProcessedSpans)
+{
+	int BorderRegionID = RegionIDs[SpanIndex];
+
+	int Span = SpanIndex;
+	int NeighborSpan;
+	int Direction = StartDirection;
+
+	int LoopCount = 0;
+	int AcuteCornerCount = 0;
+	int ObtuseCornerCount = 0;
+	int StepsWithoutBorder = 0;
+	bool BorderSeenLastLoop = false;
+	bool IsBorder = true;
+
+	bool HasSingleConnection = true;
+
+	while (LoopCount < INT_MAX)
+	{
+		NeighborSpan = GetAxisNeighbor(Span, Direction);
+
+		if (NeighborSpan == NULL_OPEN_SPAN)
+		{
+			IsBorder = true;
+		}
+		else
+		{
+			ProcessedSpans[NeighborSpan] = true;
+			if (RegionIDs[NeighborSpan] == NULL_REGION)
+			{
+				IsBorder = true;
 			}
-			else if(!UseOnlyNullRegionSpans)
+			else
 			{
-				EdgeDirection = CurrentSpan->GetNullEdgeDirection();
-				if (EdgeDirection == -1)
+				IsBorder = false;
+				if (RegionIDs[NeighborSpan] != BorderRegionID)
 				{
-					CurrentSpan = CurrentSpan->nextSpan;
-					continue;
+					HasSingleConnection = false;
 				}
-				WorkingSpan = CurrentSpan;
 			}
-			else
+		}
+
+		if (IsBorder)
+		{
+			if (BorderSeenLastLoop)
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
-				continue;
+				AcuteCornerCount++;
+			}
+			else if (StepsWithoutBorder > 1)
+			{
+				ObtuseCornerCount++;
+				StepsWithoutBorder = 0;
+
+				if (ProcessOuterCorner(Span, Direction))
+				{
+					HasSingleConnection = false;
+				}
+			}
+
+			Direction = FOpenSpan::IncreaseNeighborDirection(Direction, 1);
+			BorderSeenLastLoop = true;
+			StepsWithoutBorder = 0;
+		}
+		else
+		{
+			Span = NeighborSpan;
+			Direction = FOpenSpan::IncreaseNeighborDirection(Direction, 3);
+			BorderSeenLastLoop = false;
+			StepsWithoutBorder++;
+		}
+
+		if (SpanIndex == Span && StartDirection == Direction)
+		{
+			return (HasSingleConnection && ObtuseCornerCount > AcuteCornerCount);
+		}
+
+		LoopCount++;
+	}
+
+	return false;
+}
+
+bool UOpenHeightfield::ProcessOuterCorner(const int SpanIndex, int BorderDirection)
+{
+	bool HasMultiRegions = false;
+
+	int BackOne = GetAxisNeighbor(SpanIndex, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 3));
+
+	//The corner can't be checked without both the spans behind it
+	if (BackOne == NULL_OPEN_SPAN)
+	{
+		return true;
+	}
+
+	int BackTwo = GetAxisNeighbor(BackOne, BorderDirection);
+
+	if (BackTwo == NULL_OPEN_SPAN)
+	{
+		return true;
+	}
+
+	int TestSpan;
+
+	if (RegionIDs[BackOne] != RegionIDs[SpanIndex] && RegionIDs[BackTwo] == RegionIDs[SpanIndex])
+	{
+		HasMultiRegions = true;
+
+		TestSpan = GetAxisNeighbor(BackOne, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 3));
+		int BackTwoConnections = 0;
+
+		if (TestSpan != NULL_OPEN_SPAN && RegionIDs[TestSpan] == RegionIDs[BackOne])
+		{
+			BackTwoConnections++;
+			TestSpan = GetAxisNeighbor(TestSpan, BorderDirection);
+
+			if (TestSpan != NULL_OPEN_SPAN && RegionIDs[TestSpan] == RegionIDs[BackOne])
+			{
+				BackTwoConnections++;
 			}
+		}
 
-			bool IsEncompassNullRegion = WorkingSpan->ProcessNullRegion(EdgeDirection);
+		int ReferenceConnections = 0;
+		TestSpan = GetAxisNeighbor(BackOne, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 2));
 
-			if (IsEncompassNullRegion)
+		if (TestSpan != NULL_OPEN_SPAN && RegionIDs[TestSpan] == RegionIDs[BackOne])
+		{
+			ReferenceConnections++;
+			TestSpan = GetAxisNeighbor(TestSpan, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 2));
+
+			if (TestSpan != NULL_OPEN_SPAN && RegionIDs[TestSpan] == RegionIDs[BackOne])
 			{
-				WorkingSpan->PartialFloodRegion(EdgeDirection, NextRegionID);
-				NextRegionID++;
+				BackTwoConnections++;
 			}
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+		if (ReferenceConnections > BackTwoConnections)
+		{
+			RegionIDs[SpanIndex] = RegionIDs[BackOne];
+		}
+		else
+		{
+			RegionIDs[BackTwo] = RegionIDs[BackOne];
+		}
 	}
+	else if (RegionIDs[BackOne] == RegionIDs[SpanIndex] && RegionIDs[BackTwo] == RegionIDs[SpanIndex])
+	{
+		int SelectedRegion = SelectedRegionID(BackTwo, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 1), FOpenSpan::IncreaseNeighborDirection(BorderDirection, 2));
+		if (SelectedRegion == RegionIDs[BackTwo])
+		{
+			SelectedRegion = SelectedRegionID(SpanIndex, BorderDirection, FOpenSpan::IncreaseNeighborDirection(BorderDirection, 3));
 
-	RegionCount = NextRegionID;
+			if (SelectedRegion != RegionIDs[SpanIndex])
+			{
+				RegionIDs[SpanIndex] = SelectedRegion;
+				HasMultiRegions = true;
+			}
+		}
+		else
+		{
+			RegionIDs[BackTwo] = SelectedRegion;
+			HasMultiRegions = true;
+		}
+	}
+	else
+	{
+		HasMultiRegions = true;
+	}
+
+	return HasMultiRegions;
+}
 
-	for (auto& Span : Spans)
+int UOpenHeightfield::GetRegionEdgeDirection(const int SpanIndex) const
+{
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
 
-		do 
+		if (NeighborSpan == NULL_OPEN_SPAN || RegionIDs[NeighborSpan] != RegionIDs[SpanIndex])
 		{
-			CurrentSpan->ProcessedForRegionFixing = false;
-			CurrentSpan = CurrentSpan->nextSpan;
-		} 
-		while (CurrentSpan);
+			return NeighborDir;
+		}
 	}
+	return -1;
+}
 
-	ReassignBorderSpan();
+int UOpenHeightfield::GetNonNullEdgeDirection(const int SpanIndex) const
+{
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+	{
+		int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+
+		if (NeighborSpan != NULL_OPEN_SPAN && RegionIDs[NeighborSpan] != NULL_REGION)
+		{
+			return NeighborDir;
+		}
+	}
+	return -1;
+}
+
+int UOpenHeightfield::GetNullEdgeDirection(const int SpanIndex) const
+{
+	for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+	{
+		int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+
+		if (NeighborSpan == NULL_OPEN_SPAN || RegionIDs[NeighborSpan] == NULL_REGION)
+		{
+			return NeighborDir;
+		}
+	}
+	return -1;
 }
 
 void UOpenHeightfield::ReassignBorderSpan()
 {
-	bool SpanChanged = true;
+	//Worklist of the spans to check, every span is checked once and then again only if one of its neighbors changes region
+	//The spans are read from the head index, so the worklist doesn't need to shift the array
+	TArray<int> DirtySpans;
+	TArray<bool> IsSpanDirty;
+	IsSpanDirty.Init(true, Spans.Num());
+
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
+	{
+		DirtySpans.Add(SpanIndex);
+	}
 
-	while(SpanChanged) 
+	int WorklistHead = 0;
+
+	while (WorklistHead < DirtySpans.Num())
 	{
-		SpanChanged = false;
+		const int SpanIndex = DirtySpans[WorklistHead++];
+		IsSpanDirty[SpanIndex] = false;
 
-		//Iterate through all the spans
-		for (auto& Span : Spans)
+		//Skip the spans in the null region
+		if (RegionIDs[SpanIndex] == NULL_REGION)
 		{
-			UOpenSpan* CurrentSpan = Span.Value;
+			continue;
+		}
 
-			do
-			{
-				//Skip the spans in the null region
-				if (CurrentSpan->RegionID == NULL_REGION)
-				{
-					CurrentSpan = CurrentSpan->nextSpan;
-					continue;
-				}
+		const int NewRegionID = GetReassignedRegionID(SpanIndex);
 
-				//Iterate through the axis spans to the one considered
-				for (int Index = 0; Index < 4; Index++)
-				{
-					UOpenSpan* AdjacentSpan = CurrentSpan->GetAxisNeighbor(Index);
-					int PlusOne = CurrentSpan->IncreaseNeighborDirection(Index, 1);
-					int MinusOne = CurrentSpan->DecreaseNeighborDirection(Index, 1);
-
-					//Reassign the spans that comply to the following conditions
-					//Have more than one adjacent axis span that has a different region ID (different from 0) from the one considered
-					//And they have the same region ID
-					if (CurrentSpan->RegionID != AdjacentSpan->RegionID && AdjacentSpan->RegionID != NULL &&
-					   (AdjacentSpan->RegionID == CurrentSpan->GetAxisNeighbor(PlusOne)->RegionID || AdjacentSpan->RegionID == CurrentSpan->GetAxisNeighbor(MinusOne)->RegionID))
-					{
-						//Reassign the span id and set the condition to repeat the loop
-						CurrentSpan->RegionID = CurrentSpan->GetAxisNeighbor(Index)->RegionID;
-						SpanChanged = true;
-						break;
-					}
-				}
+		if (NewRegionID == NULL_REGION)
+		{
+			continue;
+		}
+
+		//Reassign the span id and check again the neighbors, as the change can make them comply to the conditions
+		RegionIDs[SpanIndex] = NewRegionID;
 
-				CurrentSpan = CurrentSpan->nextSpan;
-			} while (CurrentSpan);
+		for (int NeighborDir = 0; NeighborDir < 4; NeighborDir++)
+		{
+			const int NeighborSpan = GetAxisNeighbor(SpanIndex, NeighborDir);
+
+			if (NeighborSpan != NULL_OPEN_SPAN && !IsSpanDirty[NeighborSpan])
+			{
+				IsSpanDirty[NeighborSpan] = true;
+				DirtySpans.Add(NeighborSpan);
+			}
 		}
 	}
 }
 
-void UOpenHeightfield::DrawDebugSpanData()
+int UOpenHeightfield::GetReassignedRegionID(const int SpanIndex) const
 {
-	for (auto& Span : Spans)
+	//Iterate through the axis spans to the one considered
+	for (int Index = 0; Index < 4; Index++)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		const int AdjacentSpan = GetAxisNeighbor(SpanIndex, Index);
+
+		//The spans on the border of the traversable area don't have all the neighbors
+		if (AdjacentSpan == NULL_OPEN_SPAN)
+		{
+			continue;
+		}
+
+		const int AdjacentRegionID = RegionIDs[AdjacentSpan];
+
+		if (AdjacentRegionID == NULL_REGION || AdjacentRegionID == RegionIDs[SpanIndex])
+		{
+			continue;
+		}
 
-		float Offset = 2.f;
+		//Reassign the spans that comply to the following conditions
+		//Have more than one adjacent axis span that has a different region ID (different from 0) from the one considered
+		//And they have the same region ID
+		const int PlusOneSpan = GetAxisNeighbor(SpanIndex, FOpenSpan::IncreaseNeighborDirection(Index, 1));
+		const int MinusOneSpan = GetAxisNeighbor(SpanIndex, FOpenSpan::DecreaseNeighborDirection(Index, 1));
 
-		do
+		if ((PlusOneSpan != NULL_OPEN_SPAN && RegionIDs[PlusOneSpan] == AdjacentRegionID) ||
+			(MinusOneSpan != NULL_OPEN_SPAN && RegionIDs[MinusOneSpan] == AdjacentRegionID))
 		{
-			FVector SpanMinCoord = FVector(BoundMin.X + CellSize * CurrentSpan->Width + Offset, BoundMin.Y + CellSize * CurrentSpan->Depth + Offset, BoundMin.Z + CellHeight * CurrentSpan->Min);
-			FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (CurrentSpan->Min));
+			return AdjacentRegionID;
+		}
+	}
+
+	return NULL_REGION;
+}
+
+void UOpenHeightfield::DrawDebugSpanData()
+{
+	float Offset = 2.f;
 
-			UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, FColor::Blue, 60.0f, 1.5f);
+	for (const FOpenSpan& CurrentSpan : Spans)
+	{
+		FVector SpanMinCoord = FVector(BoundMin.X + CellSize * CurrentSpan.Width + Offset, BoundMin.Y + CellSize * CurrentSpan.Depth + Offset, BoundMin.Z + CellHeight * CurrentSpan.Min);
+		FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (CurrentSpan.Min));
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} while (CurrentSpan);
+		UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, FColor::Blue, 60.0f, 1.5f);
 	}
 }
 
-void UOpenHeightfield::DrawSpanNeighbor(UOpenSpan* Span, const bool DebugNumbersVisible)
+void UOpenHeightfield::DrawSpanNeighbor(const int SpanIndex, const bool DebugNumbersVisible)
 {
 	float CenterOffset = CellSize / 2;
 	float Offset = 2.f;
 	int NeighborNumber = 0;
-	UOpenSpan* CurrentSpan = Span;
+	const FOpenSpan& CurrentSpan = Spans[SpanIndex];
 
 	//Draw the current span
-	FVector SpanMinCoord = FVector(BoundMin.X + CellSize * CurrentSpan->Width + Offset, BoundMin.Y + CellSize * CurrentSpan->Depth + Offset, BoundMin.Z + CellHeight * CurrentSpan->Min);
-	FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (CurrentSpan->Min));
+	FVector SpanMinCoord = FVector(BoundMin.X + CellSize * CurrentSpan.Width + Offset, BoundMin.Y + CellSize * CurrentSpan.Depth + Offset, BoundMin.Z + CellHeight * CurrentSpan.Min);
+	FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (CurrentSpan.Min));
 	UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, FColor::Red, 20.0f, 0.5f);
 
 	FActorSpawnParameters SpawnInfo;
@@ -1093,21 +2066,22 @@ void UOpenHeightfield::DrawSpanNeighbor(UOpenSpan* Span, const bool DebugNumbers
 	for (int Dir = 0; Dir < 4; Dir++)
 	{
 		//Axis
-		UOpenSpan* NeighborSpan = CurrentSpan->GetAxisNeighbor(Dir);
-		if (!NeighborSpan)
+		int NeighborIndex = GetAxisNeighbor(SpanIndex, Dir);
+		if (NeighborIndex == NULL_OPEN_SPAN)
 		{
 			continue;
 		}
 
 		//Update the data to draw the axis neighbor span
-		SpanMinCoord = FVector(BoundMin.X + CellSize * NeighborSpan->Width + Offset, BoundMin.Y + CellSize * NeighborSpan->Depth + Offset, BoundMin.Z + CellHeight * NeighborSpan->Min);
-		SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (NeighborSpan->Min));
+		const FOpenSpan& NeighborSpan = Spans[NeighborIndex];
+		SpanMinCoord = FVector(BoundMin.X + CellSize * NeighborSpan.Width + Offset, BoundMin.Y + CellSize * NeighborSpan.Depth + Offset, BoundMin.Z + CellHeight * NeighborSpan.Min);
+		SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellHeight * (NeighborSpan.Min));
 		UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, FColor::Blue, 20.0f, 0.5f);
 
 		FVector SpanCenterCoord;
 		if (DebugNumbersVisible)
 		{
-			SpanCenterCoord = FVector(BoundMin.X + CellSize * NeighborSpan->Width + CenterOffset, BoundMin.Y + CellSize * NeighborSpan->Depth + CenterOffset, BoundMin.Z + CellHeight * NeighborSpan->Min + CenterOffset);
+			SpanCenterCoord = FVector(BoundMin.X + CellSize * NeighborSpan.Width + CenterOffset, BoundMin.Y + CellSize * NeighborSpan.Depth + CenterOffset, BoundMin.Z + CellHeight * NeighborSpan.Min + CenterOffset);
 			ATextRenderActor* Text = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
 			FString TextToDisplay = FString::FromInt(NeighborNumber);
 			Text->GetTextRender()->SetText(FText::FromString(TextToDisplay));
@@ -1118,20 +2092,21 @@ void UOpenHeightfield::DrawSpanNeighbor(UOpenSpan* Span, const bool DebugNumbers
 		NeighborNumber++;
 
 		//Diagonal
-		NeighborSpan = NeighborSpan->GetDiagonalNeighbor(Dir);
-		if (!NeighborSpan)
+		int DiagonalIndex = GetDiagonalNeighbor(NeighborIndex, Dir);
+		if (DiagonalIndex == NULL_OPEN_SPAN)
 		{
 			continue;
 		}
 
 		//Update the data to draw the diagonal neighbor span
-		SpanMinCoord = FVector(BoundMin.X + CellSize * NeighborSpan->Width + Offset, BoundMin.Y + CellSize * NeighborSpan->Depth + Offset, BoundMin.Z + CellHeight * NeighborSpan->Min);
-		SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellSize * (NeighborSpan->Min));
+		const FOpenSpan& DiagonalSpan = Spans[DiagonalIndex];
+		SpanMinCoord = FVector(BoundMin.X + CellSize * DiagonalSpan.Width + Offset, BoundMin.Y + CellSize * DiagonalSpan.Depth + Offset, BoundMin.Z + CellHeight * DiagonalSpan.Min);
+		SpanMaxCoord = FVector(SpanMinCoord.X + CellSize - Offset, SpanMinCoord.Y + CellSize - Offset, BoundMin.Z + CellSize * (DiagonalSpan.Min));
 		UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, FColor::Blue, 20.0f, 0.5f);
 
 		if (DebugNumbersVisible)
 		{
-			SpanCenterCoord = FVector(BoundMin.X + CellSize * NeighborSpan->Width + CenterOffset, BoundMin.Y + CellSize * NeighborSpan->Depth + CenterOffset, BoundMin.Z + CellHeight * NeighborSpan->Min + CenterOffset);
+			SpanCenterCoord = FVector(BoundMin.X + CellSize * DiagonalSpan.Width + CenterOffset, BoundMin.Y + CellSize * DiagonalSpan.Depth + CenterOffset, BoundMin.Z + CellHeight * DiagonalSpan.Min + CenterOffset);
 			ATextRenderActor* Text2 = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
 			FString TextToDisplay = FString::FromInt(NeighborNumber);
 			Text2->GetTextRender()->SetText(FText::FromString(TextToDisplay));
@@ -1150,34 +2125,28 @@ void UOpenHeightfield::DrawDistanceFieldDebugData(const bool DebugNumbersVisible
 	float OffSet = 0.02;
 	float ScalingValue = CellSize / 100 - OffSet;
 
-	for (auto& Span : Spans)
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
+		const FOpenSpan& CurrentSpan = Spans[SpanIndex];
+		FVector SpanCenterCoord = FVector(BoundMin.X + CellSize * CurrentSpan.Width + CenterOffset, BoundMin.Y + CellSize * CurrentSpan.Depth + CenterOffset, BoundMin.Z + CellHeight * CurrentSpan.Min + CenterOffset);
+		
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
-		do
+		if (DebugNumbersVisible)
 		{
-			FVector SpanCenterCoord = FVector(BoundMin.X + CellSize * CurrentSpan->Width + CenterOffset, BoundMin.Y + CellSize * CurrentSpan->Depth + CenterOffset, BoundMin.Z + CellHeight * CurrentSpan->Min + CenterOffset);
-			
-			FActorSpawnParameters SpawnInfo;
-			SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-
-			if (DebugNumbersVisible)
-			{
-				ATextRenderActor* Text = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
-				FString TextToDisplay = FString::FromInt(CurrentSpan->DistanceToBorder);
-				Text->GetTextRender()->SetText(FText::FromString(TextToDisplay));
-				Text->GetTextRender()->SetTextRenderColor(FColor::Red);
-			}
-
-			if (DebugPlanesVisible)
-			{
-				AMeshDebug* Mesh = CurrentWorld->SpawnActor<AMeshDebug>(SpanCenterCoord, FRotator(0.f, 0.f, 0.f), SpawnInfo);
-				Mesh->SetActorScale3D(FVector(ScalingValue, ScalingValue, 0.01f));
-				Mesh->SetMaterialColorOnDistance(CurrentSpan->DistanceToBorder, MaxBorderDistance);
-			}
+			ATextRenderActor* Text = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
+			FString TextToDisplay = FString::FromInt(BorderDistances[SpanIndex]);
+			Text->GetTextRender()->SetText(FText::FromString(TextToDisplay));
+			Text->GetTextRender()->SetTextRenderColor(FColor::Red);
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} while (CurrentSpan);
+		if (DebugPlanesVisible)
+		{
+			AMeshDebug* Mesh = CurrentWorld->SpawnActor<AMeshDebug>(SpanCenterCoord, FRotator(0.f, 0.f, 0.f), SpawnInfo);
+			Mesh->SetActorScale3D(FVector(ScalingValue, ScalingValue, 0.01f));
+			Mesh->SetMaterialColorOnDistance(BorderDistances[SpanIndex], MaxBorderDistance);
+		}
 	}
 }
 
@@ -1188,33 +2157,27 @@ void UOpenHeightfield::DrawDebugRegions(const bool DebugNumbersVisible, const bo
 	float OffSet = 0.02;
 	float ScalingValue = CellSize / 100 - OffSet;
 
-	for (auto& Span : Spans)
+	for (int SpanIndex = 0; SpanIndex < Spans.Num(); SpanIndex++)
 	{
-		UOpenSpan* CurrentSpan = Span.Value;
-
-		do
-		{
-			FVector SpanCenterCoord = FVector(BoundMin.X + CellSize * CurrentSpan->Width + CenterOffset, BoundMin.Y + CellSize * CurrentSpan->Depth + CenterOffset, BoundMin.Z + CellHeight * CurrentSpan->Min + CenterOffset);
-
-			FActorSpawnParameters SpawnInfo;
-			SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const FOpenSpan& CurrentSpan = Spans[SpanIndex];
+		FVector SpanCenterCoord = FVector(BoundMin.X + CellSize * CurrentSpan.Width + CenterOffset, BoundMin.Y + CellSize * CurrentSpan.Depth + CenterOffset, BoundMin.Z + CellHeight * CurrentSpan.Min + CenterOffset);
 
-			if (DebugNumbersVisible)
-			{
-				ATextRenderActor* Text = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
-				FString TextToDisplay = FString::FromInt(CurrentSpan->RegionID);
-				Text->GetTextRender()->SetText(FText::FromString(TextToDisplay));
-				Text->GetTextRender()->SetTextRenderColor(FColor::Red);
-			}
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
-			if (DebugPlanesVisible)
-			{
-				AMeshDebug* Mesh = CurrentWorld->SpawnActor<AMeshDebug>(SpanCenterCoord, FRotator(0.f, 0.f, 0.f), SpawnInfo);
-				Mesh->SetActorScale3D(FVector(ScalingValue, ScalingValue, 0.01f));
-				Mesh->SetMaterialColorOnDistance(CurrentSpan->RegionID, MaxBorderDistance);
-			}
+		if (DebugNumbersVisible)
+		{
+			ATextRenderActor* Text = CurrentWorld->SpawnActor<ATextRenderActor>(SpanCenterCoord, FRotator(0.f, 180.f, 0.f), SpawnInfo);
+			FString TextToDisplay = FString::FromInt(RegionIDs[SpanIndex]);
+			Text->GetTextRender()->SetText(FText::FromString(TextToDisplay));
+			Text->GetTextRender()->SetTextRenderColor(FColor::Red);
+		}
 
-			CurrentSpan = CurrentSpan->nextSpan;
-		} while (CurrentSpan);
+		if (DebugPlanesVisible)
+		{
+			AMeshDebug* Mesh = CurrentWorld->SpawnActor<AMeshDebug>(SpanCenterCoord, FRotator(0.f, 0.f, 0.f), SpawnInfo);
+			Mesh->SetActorScale3D(FVector(ScalingValue, ScalingValue, 0.01f));
+			Mesh->SetMaterialColorOnDistance(RegionIDs[SpanIndex], MaxBorderDistance);
+		}
 	}
 }
@@ -9,10 +9,31 @@
 
 #define REGION_MAX_BORDER 10000
 
+//Number of spans processed by every task of the parallel region expansion
+#define REGION_EXPANSION_CHUNK_SIZE 1024
+
+//Number of rows swept by every task while gathering the regions data
+#define REGION_GATHER_BAND_ROWS 16
+
 class USolidHeightfield;
-class URegion;
+struct FRegion;
+struct FRegionIDTable;
+enum class RegionPartitioning : uint8;
 class ANavMeshController;
 
+//Run of connected spans in a row built by the monotone partitioning
+struct FRegionSweep
+{
+	//Region assigned to the spans of the sweep
+	int RegionID = NULL_REGION;
+
+	//Region of the previous row connected to the sweep, INDEX_NONE if the sweep is connected to more than one region
+	int NeighborRegionID = NULL_REGION;
+
+	//Number of spans of the sweep connected to NeighborRegionID
+	int NeighborCount = 0;
+};
+
 UCLASS()
 class NAVMESH_GENERATION_API UOpenHeightfield : public UBaseHeightfield
 {
@@ -25,64 +46,158 @@ public:
 	//Detect the open areas in the heighfield and add them to the openspan data container
 	void FindOpenSpanData(const USolidHeightfield* SolidHeightfield);
 
+	/*Same as above, only the solid columns inside the area passed in (in open heightfield grid coordinates, max excluded) are considered
+	  The solid heightfield can cover a part of the open one, as long as the two grids are aligned, like when the build is performed in chunks*/
+	void FindOpenSpanData(const USolidHeightfield* SolidHeightfield, const FIntRect& Area);
+
+	//Reorder the spans row by row, so that they are stored and processed in the same order no matter the order in which the columns were added
+	void SortSpans();
+
+	//Get the index of the axis neighbor of the span in the direction passed in, NULL_OPEN_SPAN if the span has no neighbor there
+	int GetAxisNeighbor(const int SpanIndex, const int Direction) const;
+
+	//Get the axis neighbor of the span in the direction following the one passed in (clockwise), used on an axis neighbor to find a diagonal neighbor
+	int GetDiagonalNeighbor(const int SpanIndex, const int Direction) const;
+
+	//Get the column the span is stored in
+	const FOpenHeightfieldCell& GetSpanCell(const int SpanIndex) const;
+
 	//Find and assign the neightbor spans of every span
 	//We only need to check and set the axis neighbor as the diagonal ones can be found by checking the axis neighbor of a neighbor span
 	//Check the GenerateDistanceField() method to see how this is achieved
+	//The rows are processed in parallel
 	void GenerateNeightborLinks();
 
+	//Find and assign the neighbor spans of all the spans in the row
+	void GenerateRowNeighborLinks(const int DepthIndex);
+
 	//First part of the distance field generation algorithm use to filter the border span from the others
 	void FindBorderSpan();
 
 	//Second part of the distance field generation algorithm use to assign a specific distance value to every span proportioned to its distance from the border
+	//The distances are computed by a two pass chamfer transform, 2 for the axis neighbors and 3 for the diagonal ones
 	void GenerateDistanceField();
 
+	//Forward and backward chamfer passes over the spans, used for any layout of the columns
+	void GenerateDistanceFieldScalar();
+
+	//Get the distance of the span through the two axis neighbors starting from the direction passed in and the diagonal neighbors reached through them
+	int GetChamferDistance(const int SpanIndex, const int FirstDirection) const;
+
+	//Return true if none of the columns contains more than one span
+	bool HasSingleLayerColumns() const;
+
+	//Same passes as GenerateDistanceField() on a dense copy of the occupied area, the neighbors in the adjacent row are processed 4 columns at a time
+	//Only valid when every column contains at most one span
+	void GenerateDistanceFieldSingleLayer();
+
+	//Smooth the distance field by replacing the distance of every span with the average of the 3x3 spans around it
+	//The spans with a distance less or equal to twice the SmoothingThreshold are left unchanged, the rows are processed in parallel
+	void BlurDistanceField();
+
+	//Write the blurred distance of all the spans in the row to the buffer passed in
+	void BlurRowDistances(const int DepthIndex, TArray<uint16>& BlurredDistances) const;
+
 	//Calculate the minimum and maximum border distance while computing the distance field
 	void CalculateBorderDistanceMinMax(const int DistanceToBorder);
 
 	//Apply the watershed algorithm - https://ch.mathworks.com/help/images/marker-controlled-watershed-segmentation.html
 	//to identify the regions based on the DistanceToBorderValue
+	//The spans are sorted once by the level they are flooded at, so every level only iterates its own spans
 	void GenerateRegions();
 
-	//Find the most appropriate regions to attach spans to after the region has been defined
-	void ExpandRegions(TArray<UOpenSpan*>& FloodedSpans, const int MaxIterations);
+	/*Find the most appropriate regions to attach spans to after the region has been defined
+	  FloodDistance is the distance from border of the current level, the spans above it are the only ones that can be added to a region
+	  After the first iteration only the spans next to the ones just added are considered again
+	  Every iteration finds the regions of the spans in parallel and assigns them at the end, so the result is deterministic*/
+	void ExpandRegions(const TArray<int>& FloodedSpans, const int FloodDistance, const int MaxIterations);
+
+	//Get the region of the neighbor closest to its region core that the span can join, NULL_REGION if there is none
+	int GetExpansionRegion(const int SpanIndex, int& OutRegionCenterDistance) const;
+
+	//Find the distance of the spans from the border without the blur and the flooding, used by the monotone and layers partitioning to leave the spans too close to the border out of the regions
+	void ErodeTraversableArea();
+
+	/*Return true if the span is closer to the border than TraversableAreaBorderSize, the distance isn't blurred
+	  So it matches the null region of GenerateRegions() except for the spans whose distance is moved across the threshold by the blur*/
+	bool IsSpanEroded(const int SpanIndex) const;
+
+	/*Alternative to GenerateRegions() that doesn't need the distance field, the rows are swept one after the other
+	  Every run of connected spans in a row continues the region of the previous row it's connected to, if no other run of the row is connected to it
+	  Otherwise the run starts a new region, the spans eroded by ErodeTraversableArea() are left in the null region*/
+	void GenerateMonotoneRegions();
+
+	//Merge every monotone region into its smallest neighbor, as long as the two regions touch along a single edge and don't overlap vertically
+	void MergeRegionLayers();
 
 	//Try creating a new region surrounding a span
-	void FloodNewRegion(UOpenSpan* RootSpan, const int FillToDistance, int& RegionID);
+	void FloodNewRegion(const int RootSpan, const int FillToDistance, int& RegionID);
 
 	//Make sure small regions are removed or merged into the bigger ones based on the MinUnconnectedRegionSize and MinMergeRegionSize parameters
 	void HandleSmallRegions();
 
+	//Create a region for every region ID and initialize them based on the data retrieved from the spans, every region starts pointing to itself in the ID table
+	void CreateRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable);
+
 	//Initialize all the data fields of the regions based on the data retrieved from the spans
-	void GatherRegionsData(TArray<URegion*>& Regions);
+	//The span counts, overlaps and first edge span of every region are found by a single sweep of the rows (in parallel bands), then the edges are walked in parallel
+	void GatherRegionsData(TArray<FRegion>& Regions);
 
 	//Find unconnected (island) regions that are below the allowed minimum size and convert them to null regions
-	void RemoveSmallUnconnectedRegions(TArray<URegion*>& Regions);
+	void RemoveSmallUnconnectedRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable);
 
-	//Search for small regions to merge with other regions
-	void MergeRegions(TArray<URegion*>& Regions);
+	//Search for regions with no more than MaxMergeSize spans to merge with other regions
+	//A merge only points the merged region to the target one in the ID table, the other regions resolve their connections when they are processed
+	void MergeRegions(TArray<FRegion>& Regions, FRegionIDTable& IDTable, const int MaxMergeSize);
 
 	//Remap the region and spans ID to make sure they are sequential 
 	//Because after the merging it can happen that the region IDs can be not longer sequential
-	void RemapRegionAndSpansID(TArray<URegion*>& Regions);
+	//The regions are remapped through the ID table in a single pass
+	void RemapRegionAndSpansID(FRegionIDTable& IDTable);
 
 	//Constrain the MinUnconnectedRegionSize and MinMergeRegionSize parameters to be positive value
 	void SetMinRegionParameters();
 
 	//Traverse the edge of a region and add all the neighbor connection found to the region connection array
-	void FindRegionConnections(UOpenSpan* Span, int NeighborDirection, TArray<int>& RegionConnection);
+	//MaxSteps bounds the walk, 4 times the span count of the region is enough for the walk to go back to its beginning
+	void FindRegionConnections(const int SpanIndex, int NeighborDirection, TArray<int>& RegionConnection, const int MaxSteps) const;
 
 	void CleanRegionBorders();
 
+	//Get the region IDs of the 8 neighbors of the span, the axis ones first and then the diagonal ones, NULL_REGION for the missing neighbors
+	void GetNeighborRegionIDs(const int SpanIndex, TArray<int>& NeighborIDs) const;
+
+	int SelectedRegionID(const int SpanIndex, int BorderDirection, int CornerDirection) const;
+
+	void PartialFloodRegion(const int SpanIndex, int BorderDirection, int NewRegionID);
+
+	bool ProcessNullRegion(const int SpanIndex, int StartDirection, TArray<bool>& ProcessedSpans);
+
+	bool ProcessOuterCorner(const int SpanIndex, int BorderDirection);
+
+	//Return the direction of the first neighbor that is contained in a different region
+	int GetRegionEdgeDirection(const int SpanIndex) const;
+
+	//Return the direction of the first neighbor in the non null region
+	int GetNonNullEdgeDirection(const int SpanIndex) const;
+
+	//Return the direction of the first neighbor in the null region
+	int GetNullEdgeDirection(const int SpanIndex) const;
+
 	//Fix issue with the spans wrapping around an adjacent region by reassign them to that region
+	//After the first pass over all the spans, only the neighbors of the reassigned spans are checked again
 	void ReassignBorderSpan();
 
+	//Get the region the span must be reassigned to, the one of two adjacent axis neighbors, NULL_REGION if the span keeps its region
+	int GetReassignedRegionID(const int SpanIndex) const;
+
 	//Draw the open span data
 	void DrawDebugSpanData();
 
 	//Draw neighbor information of a span both axis and diagonal
 	//A debug number will appear on top of the neghbor spans if the debug is visible
 	//The neighbor spans order is process in clockwise direction
-	void DrawSpanNeighbor(UOpenSpan* Span, const bool DebugNumbersVisible);
+	void DrawSpanNeighbor(const int SpanIndex, const bool DebugNumbersVisible);
 	
 	//Draw the distance field data
 	void DrawDistanceFieldDebugData(const bool DebugNumbersVisible, const bool DebugPlanesVisible);
@@ -91,10 +206,13 @@ public:
 	void DrawDebugRegions(const bool DebugNumbersVisible, const bool DebugPlanesVisible);
 
 	bool GetPerformFullGeneration() { return PerformFullGeneration; }
+	RegionPartitioning GetPartitioning() const { return Partitioning; }
 
 	const int GetRegionCount() const { return RegionCount; };
 	const FVector GetBoundMin() const { return BoundMin; };
-	const TMap<int, UOpenSpan*> GetSpans() const { return Spans; };
+	const TArray<FOpenHeightfieldCell>& GetCells() const { return Cells; };
+	const TArray<FOpenSpan>& GetSpans() const { return Spans; };
+	const TArray<int>& GetRegionIDs() const { return RegionIDs; };
 
 private:
 	//Minimum distance from the border based on the data retrieved by looking at the DistanceToBorder value of the single spans
@@ -118,7 +236,27 @@ private:
 
 	bool UseConservativeExpansion;
 
-	//Container of all the open spans contained in the heightfield
-	UPROPERTY()
-	TMap<int, UOpenSpan*> Spans;
+	RegionPartitioning Partitioning;
+
+	//Use the vectorized kernel to compute the distance field when the columns have a single span
+	bool EnableVectorization;
+
+	//Columns of the heightfield, stored row by row (Width * Depth entries)
+	TArray<FOpenHeightfieldCell> Cells;
+
+	//All the open spans of the heightfield, the spans of a column are contiguous
+	TArray<FOpenSpan> Spans;
+
+	//Data of the spans computed by the later stages, stored in arrays parallel to the spans one so that every pass only touches the data it needs
+	//The distance of a span from a border - distance is retrieved by looking at the neightbor cell, it is not real distance
+	TArray<uint16> BorderDistances;
+
+	//The distance of a span from the center of the region it belongs to
+	TArray<int> RegionCoreDistances;
+
+	//Region a span belongs to, NULL_REGION is the default value meaning no region is assigned
+	TArray<int> RegionIDs;
+
+	//Work queue of the spans to process in FloodNewRegion, kept between the calls to reuse its allocation
+	TArray<int> FloodQueue;
 };
@@ -8,49 +8,50 @@
 
 #define NULL_REGION 0
 
-UCLASS()
-class NAVMESH_GENERATION_API UOpenSpan : public UObject
-{
-	GENERATED_BODY()
-
-public:
-	UOpenSpan() {};
-
-	UOpenSpan(const int MinHeight, const int MaxHeight);
-
-	//Set the axis neghbor pointers of the span passed in
-	void SetAxisNeighbor(const int Direction, UOpenSpan* NeighborSpan);
+//Index used for a missing open span, like the neighbor of a span at the edge of the traversable area
+#define NULL_OPEN_SPAN -1
 
-	//Get the specific axis neighbor of a span based on the direction passed in (the neighbor information are stored clockwise) 
-	UOpenSpan* GetAxisNeighbor(const int Direction);
+//Number of bits used to store the layer of a neighbor span inside its column
+#define OPEN_SPAN_LAYER_BITS 6
 
-	//Get the specific diagonal neighbor of a span based on the direction passed in (the neighbor information are stored clockwise) 
-	UOpenSpan* GetDiagonalNeighbor(const int Direction);
+//Connection value of a direction without a traversable neighbor, also the maximum number of spans stored in a column
+#define NOT_CONNECTED ((1 << OPEN_SPAN_LAYER_BITS) - 1)
 
-	void GetNeighborRegionIDs(TArray<int>& NeighborIDs);
-	
-	int SelectedRegionID(int BorderDirection, int CornerDirection);
+//Number of bits used to store the index of the first span of a column
+#define OPEN_CELL_INDEX_BITS 24
 
-	void PartialFloodRegion(int BorderDirection, int NewRegionID);
+//Maximum number of open spans a heightfield can store
+#define OPEN_SPAN_MAX_COUNT (1 << OPEN_CELL_INDEX_BITS)
 
-	bool ProcessNullRegion(int StartDirection);
+//Ceiling of the open spans without any solid span above them
+#define OPEN_SPAN_MAX_HEIGHT 0xFFFF
 
-	bool ProcessOuterCorner(int BorderDirection);
+/*Column of the open heightfield, the spans of the column are stored one after the other inside the span array of the heightfield
+  The bitfields have no default value, the cells are always allocated zeroed (empty column)*/
+USTRUCT()
+struct FOpenHeightfieldCell
+{
+	GENERATED_USTRUCT_BODY()
 
-	//Return the direction of the first neighbor that is contained in a different region
-	int GetRegionEdgeDirection();
-	
-	//Return the direction of the first neighbor in the non null region
-	int GetNonNullEdgeDirection();
+	//Index of the lowest span of the column
+	uint32 Index : OPEN_CELL_INDEX_BITS;
 
-	//Return the direction of the first neighbor in the null region
-	int GetNullEdgeDirection();
+	//Number of spans in the column, from the bottom to the top
+	uint32 Count : 32 - OPEN_CELL_INDEX_BITS;
+};
 
-	void ResetNeighborRegionFlag();
+/*Open span data packed in 12 bytes, the distance field and region data of the spans are stored by the heightfield in separate arrays
+  The neighbors are referenced by their layer inside the adjacent column, so the spans can be moved without updating the links*/
+USTRUCT()
+struct FOpenSpan
+{
+	GENERATED_USTRUCT_BODY()
 
-	bool CheckNeighborRegionFlag();
+	//Get the layer of the axis neighbor inside its column, NOT_CONNECTED if there's no traversable neighbor in the direction passed in
+	int GetConnection(const int Direction) const { return (Connections >> (Direction * OPEN_SPAN_LAYER_BITS)) & NOT_CONNECTED; };
 
-	bool GetNeighborRegionFlag(const int Direction);
+	//Set the layer of the axis neighbor in the direction passed in (the neighbor information are stored clockwise)
+	void SetConnection(const int Direction, const int Layer);
 
 	static int IncreaseNeighborDirection(int Direction, int Increment);
 
@@ -58,41 +59,17 @@ public:
 	static int DecreaseNeighborDirection(int Direction, int Decrement);
 
 	//Width of the span
-	int Width = 0;
-
-	//Dpeth of the span
-	int Depth = 0;
-
-	//Min height of the span
-	int Min = 0;
-
-	//Max height of the span
-	int Max = 0;
-
-	//The distance of the current span from a border - distance is retrieved by looking at the neightbor cell, it is not real distance
-	int DistanceToBorder = 0;
-
-	//The distance of the current span from the center of the region it belongs to
-	int DistanceToRegionCore = 0;
-
-	//Flag to indicate the region the span belongs to, 0 is default value meaning no region is assigned
-	int RegionID = NULL_REGION;
+	uint16 Width = 0;
 
-	bool ProcessedForRegionFixing = false;
+	//Depth of the span
+	uint16 Depth = 0;
 
-	//Next span in the column (check heightspan to know why the uproperty is used)
-	UPROPERTY()
-	UOpenSpan* nextSpan;	
+	//Min height of the span (floor)
+	uint16 Min = 0;
 
-	//Neightbor spans
-	UPROPERTY()
-	UOpenSpan* NeighborConnection0;
-	UPROPERTY()
-	UOpenSpan* NeighborConnection1;
-	UPROPERTY()
-	UOpenSpan* NeighborConnection2;
-	UPROPERTY()
-	UOpenSpan* NeighborConnection3;
+	//Max height of the span (ceiling), OPEN_SPAN_MAX_HEIGHT if there is nothing above
+	uint16 Max = 0;
 
-	TArray<bool> NeighborInDiffRegion = { false, false, false, false };
+	//Layer of the 4 axis neighbors, OPEN_SPAN_LAYER_BITS each
+	uint32 Connections = 0xFFFFFFFF;
 };
@@ -3,30 +3,88 @@
 
 #include "Region.h"
 
-void URegion::ResetID(const int NewRegionID)
+void FRegionIDTable::Init(const int RegionCount)
+{
+	Parents.SetNumUninitialized(RegionCount);
+
+	for (int RegionID = 0; RegionID < RegionCount; RegionID++)
+	{
+		Parents[RegionID] = RegionID;
+	}
+}
+
+int FRegionIDTable::Find(int RegionID)
+{
+	//Every region visited is pointed to its grandparent, which halves the path for the next searches
+	while (Parents[RegionID] != RegionID)
+	{
+		Parents[RegionID] = Parents[Parents[RegionID]];
+		RegionID = Parents[RegionID];
+	}
+
+	return RegionID;
+}
+
+void FRegionIDTable::Replace(const int RegionID, const int NewRegionID)
+{
+	Parents[Find(RegionID)] = Find(NewRegionID);
+}
+
+void FRegion::Reset()
 {
-	ID = NewRegionID;
 	SpanCount = 0;
 	Connections.Empty();
 	OverlappingRegions.Empty();
 }
 
-bool URegion::CanRegionBeMergedWith(URegion* OtherRegion)
+void FRegion::ResolveRegionIDs(FRegionIDTable& IDTable)
+{
+	bool ConnectionChanged = false;
+
+	for (int& ConnectionID : Connections)
+	{
+		const int NewID = IDTable.Find(ConnectionID);
+
+		if (NewID != ConnectionID)
+		{
+			ConnectionID = NewID;
+			ConnectionChanged = true;
+		}
+	}
+
+	//Make sure no duplicates exists, if the ID are replaced
+	if (ConnectionChanged)
+	{
+		RemoveAdjacentDuplicateConnections();
+	}
+
+	//Different overlapping regions can be merged into the same one
+	TArray<int> ResolvedOverlaps;
+
+	for (int OverlapID : OverlappingRegions)
+	{
+		ResolvedOverlaps.AddUnique(IDTable.Find(OverlapID));
+	}
+
+	OverlappingRegions = MoveTemp(ResolvedOverlaps);
+}
+
+bool FRegion::CanRegionBeMergedWith(const FRegion& OtherRegion) const
 {
 	int ValidConnections = 0;
 	for (int ConnectionID : Connections)
 	{
-		if (ConnectionID == OtherRegion->ID)
+		if (ConnectionID == OtherRegion.ID)
 		{
 			ValidConnections++;
 		}
 	}
 
-	// If the regions compared are 
+	// If the regions compared are
 	// 1 - Connecting in more than one point or they do not connect
 	// 2 - Overlapping vertically
 	// They cannot be merged
-	if (ValidConnections != 1 || OverlappingRegions.Contains(OtherRegion->ID) || OtherRegion->OverlappingRegions.Contains(ID))
+	if (ValidConnections != 1 || OverlappingRegions.Contains(OtherRegion.ID) || OtherRegion.OverlappingRegions.Contains(ID))
 	{
 		return false;
 	}
@@ -34,32 +92,32 @@ bool URegion::CanRegionBeMergedWith(URegion* OtherRegion)
 	return true;
 }
 
-bool URegion::PerformRegionMergingIn(URegion* TargetRegion)
+bool FRegion::PerformRegionMergingIn(FRegion& TargetRegion) const
 {
 	//Get the ID of where the target region connects with the current one considered
-	int ConnectionPointOnTarget = TargetRegion->Connections.IndexOfByKey(ID);
+	int ConnectionPointOnTarget = TargetRegion.Connections.IndexOfByKey(ID);
 	if (ConnectionPointOnTarget == -1)
 	{
 		return false;
 	}
 
 	//Get the ID of where the current region connects the target one
-	int ConnectionPointOnCurrent = Connections.IndexOfByKey(TargetRegion->ID);
+	int ConnectionPointOnCurrent = Connections.IndexOfByKey(TargetRegion.ID);
 	if (ConnectionPointOnCurrent == -1)
 	{
 		return false;
 	}
 
 	//Save connection information before rebuilding them
-	TArray<int> TargetConnections = TargetRegion->Connections;
-	TargetRegion->Connections.Empty();
+	TArray<int> TargetConnections = TargetRegion.Connections;
+	TargetRegion.Connections.Empty();
 	int ConnectionSize = TargetConnections.Num();
 
-	//To rebuild the target connection start from the connection point after the one found with the current region and loop back to the one prior it 
+	//To rebuild the target connection start from the connection point after the one found with the current region and loop back to the one prior it
 	for (int i = 0; i < ConnectionSize - 1; i++)
 	{
 		int ConnectionToAdd = TargetConnections[(ConnectionPointOnTarget + 1 + i) % ConnectionSize];
-		TargetRegion->Connections.Add(ConnectionToAdd);
+		TargetRegion.Connections.Add(ConnectionToAdd);
 	}
 
 	//Insert current connections into target connections at their mutual connection point
@@ -67,28 +125,28 @@ bool URegion::PerformRegionMergingIn(URegion* TargetRegion)
 	for (int i = 0; i < ConnectionSize - 1; i++)
 	{
 		int ConnectionToAdd = Connections[(ConnectionPointOnCurrent + 1 + i) % ConnectionSize];
-		TargetRegion->Connections.Add(ConnectionToAdd);
+		TargetRegion.Connections.Add(ConnectionToAdd);
 	}
 
 	//Remove duplicates
-	TargetRegion->RemoveAdjacentDuplicateConnections();
+	TargetRegion.RemoveAdjacentDuplicateConnections();
 
 	//Add overlap data from the current to the target
 	for (int i : OverlappingRegions)
 	{
-		if (!TargetRegion->OverlappingRegions.Contains(i))
+		if (!TargetRegion.OverlappingRegions.Contains(i))
 		{
-			TargetRegion->OverlappingRegions.Add(i);
+			TargetRegion.OverlappingRegions.Add(i);
 		}
 	}
 
 	//Update the span count to the new total
-	TargetRegion->SpanCount += SpanCount;
+	TargetRegion.SpanCount += SpanCount;
 
 	return true;
 }
 
-void URegion::RemoveAdjacentDuplicateConnections()
+void FRegion::RemoveAdjacentDuplicateConnections()
 {
 	int Connection = 0;
 
@@ -96,7 +154,7 @@ void URegion::RemoveAdjacentDuplicateConnections()
 	while (Connection < Connections.Num() && Connections.Num() > 1)
 	{
 		int NextConnection = Connection + 1;
-		
+
 		//If the last connection is reached, loop back to the first one
 		if (NextConnection >= Connections.Num())
 		{
@@ -115,33 +173,3 @@ void URegion::RemoveAdjacentDuplicateConnections()
 		}
 	}
 }
-
-void URegion::ReplaceNeighborRegionID(int OldID, int NewID)
-{
-	bool ConnectionChanged = false;
-
-	//Iterate through the connection array and, if old region id are found, replace them with the new one
-	for (int i = 0; i < Connections.Num(); i++)
-	{
-		if (Connections[i] == OldID)
-		{
-			Connections[i] = NewID;
-			ConnectionChanged = true;
-		}
-	}
-
-	//Do the same for the overlapping region
-	for (int i = 0; i < OverlappingRegions.Num(); i++)
-	{
-		if (OverlappingRegions[i] == OldID)
-		{
-			OverlappingRegions[i] = NewID;
-		}
-	}
-
-	//Make sure no duplicates exists, if the ID are replaced succesfully
-	if (ConnectionChanged)
-	{
-		RemoveAdjacentDuplicateConnections();
-	}
-}
@@ -6,39 +6,48 @@
 #include "UObject/NoExportTypes.h"
 #include "Region.generated.h"
 
+/*Union-find table of the region IDs, every merged or removed region points to the region that replaced it
+  The removed regions point to the null region (0), which always points to itself*/
+struct FRegionIDTable
+{
+	//Every region starts pointing to itself
+	void Init(const int RegionCount);
+
+	//Get the region currently representing the one passed in, the table is compressed along the way
+	int Find(int RegionID);
 
-UCLASS()
-class NAVMESH_GENERATION_API URegion : public UObject
+	//Point the region passed in, and all the regions already merged into it, to the new one
+	void Replace(const int RegionID, const int NewRegionID);
+
+	TArray<int> Parents;
+};
+
+USTRUCT()
+struct FRegion
 {
-	GENERATED_BODY()
+	GENERATED_USTRUCT_BODY()
+
+	//Empty all the region data, performed once the region has been merged or removed
+	void Reset();
 
-public:
-	URegion() {};
+	//Replace the IDs of the merged and removed regions inside the connections and the overlaps with the ones of the regions replacing them
+	void ResolveRegionIDs(FRegionIDTable& IDTable);
 
-	//Reset the region ID and empty all the related data
-	void ResetID(const int NewRegionID);
-	
-	//Check if the current region can be merged with another one
-	bool CanRegionBeMergedWith(URegion* OtherRegion);
+	//Check if the current region can be merged with another one, the IDs of both regions must be resolved
+	bool CanRegionBeMergedWith(const FRegion& OtherRegion) const;
 
 	//Merge the current region into the target one
-	bool PerformRegionMergingIn(URegion* TargetRegion);
+	bool PerformRegionMergingIn(FRegion& TargetRegion) const;
 
 	//Remove not needed adjacent connections in the Connections array
 	void RemoveAdjacentDuplicateConnections();
 
-	//Replace the old connections of a region with new ones
-	//This operation is performed during the region merging to remove connection reference to the not-existent region (the one merged)
-	void ReplaceNeighborRegionID(int OldID, int NewID);
-	
-	//ID of the region considered
+	//ID of the region considered, equal to its index in the region array
 	int ID = 0;
 
 	//Number of spans belonging to this region
 	int SpanCount = 0;
 
-	bool IDRemapNeeded = false;
-
 	//Represents an ordered list of connections between this and other regions
 	TArray<int> Connections;
 
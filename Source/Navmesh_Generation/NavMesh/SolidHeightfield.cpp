@@ -4,8 +4,32 @@
 #include "SolidHeightfield.h"
 #include "OpenHeightfield.h"
 #include "NavMeshController.h"
+#include "../Navmesh_Generation.h"
 #include "../Utility/UtilityDebug.h"
 #include "../Utility/UtilityGeneral.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Prepare triangles (vectorized)"), STAT_PrepareTrianglesVectorized, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Prepare triangles (scalar)"), STAT_PrepareTrianglesScalar, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Rasterize triangles"), STAT_RasterizeTriangles, STATGROUP_NavMeshGeneration);
+DECLARE_CYCLE_STAT(TEXT("Filter solid spans"), STAT_FilterSolidSpans, STATGROUP_NavMeshGeneration);
+
+FBox FVoxelGeometry::GetBounds() const
+{
+	FBox Bounds(ForceInit);
+
+	for (const FVector& Vertex : Vertices)
+	{
+		Bounds += Vertex;
+	}
+
+	for (const FBox& Box : Boxes)
+	{
+		Bounds += Box;
+	}
+
+	return Bounds;
+}
 
 void USolidHeightfield::InitializeParameters(const ANavMeshController* NavController)
 {
@@ -15,10 +39,11 @@ void USolidHeightfield::InitializeParameters(const ANavMeshController* NavContro
 	MaxTraversableAngle = NavController->MaxTraversableAngle;
 	MinTraversableHeight = NavController->MinTraversableHeight;
 	MaxTraversableStep = NavController->MaxTraversableStep;
+	EnableVectorization = NavController->EnableVectorization;
 	CalculateUpNormal();
 }
 
-void USolidHeightfield::DefineFieldsBounds(const FVector AreaCenter, const FVector AreaExtent)
+void USolidHeightfield::DefineFieldsBounds(const FVector AreaCenter, const FVector AreaExtent, const bool AllocateColumns)
 {
 	BoundMin = AreaCenter - AreaExtent;
 	BoundMax = AreaCenter + AreaExtent;
@@ -26,511 +51,603 @@ void USolidHeightfield::DefineFieldsBounds(const FVector AreaCenter, const FVect
 	//Ricalculate width, depth and height based on the new bounds
 	CalculateWidthDepthHeight();
 
+	//Allocate an empty column for every cell of the grid
+	if (AllocateColumns)
+	{
+		SpanColumns.Init(0, 0, Width, Depth);
+		ResetOccupiedRows();
+	}
+	else
+	{
+		ReleaseSpans();
+	}
+
 	//Draw debug info relative to the bounding box surrounding the mesh
 	//UUtilityDebug::DrawMinMaxBox(CurrentWorld, BoundMin, BoundMax, FColor::Red, 20.0f, 2.0f);
 }
 
-void USolidHeightfield::VoxelizeTriangles(const TArray<FVector>& Vertices, const TArray<int> Indices)
+void USolidHeightfield::DefineChunkBounds(const FVoxelGrid& FieldGrid, const FIntRect& Area)
 {
-	const float InvertCellSize = 1 / CellSize;
-	const float InvertCellHeight = 1 / CellHeight;
+	BoundMin = FieldGrid.BoundMin + FVector(Area.Min.X * CellSize, Area.Min.Y * CellSize, 0.f);
+	BoundMax = FVector(FieldGrid.BoundMin.X + Area.Max.X * CellSize, FieldGrid.BoundMin.Y + Area.Max.Y * CellSize, FieldGrid.BoundMax.Z);
 
-	float SolidFieldMinHeight = 0;
-	float SolidFieldMaxHeight = 0;
-	FindGeometryHeight(Vertices, SolidFieldMinHeight, SolidFieldMaxHeight);
-
-	int PolyCount = Indices.Num() / 3;
+	CalculateWidthDepthHeight();
 
-	for (int PolyIndex = 0; PolyIndex < PolyCount; PolyIndex++)
-	{
-		TArray<FVector> PolyVertices;
+	//The size is taken from the area instead of being rounded from the bounds, so the chunk can't end up with an extra column
+	Width = Area.Width();
+	Depth = Area.Height();
 
-		//Find the vertices coordinates for every triangle of the mesh and add them to the array
-		FVector VertexA = FVector(Vertices[PolyIndex * 3].X, Vertices[PolyIndex * 3].Y, Vertices[PolyIndex * 3].Z);
-		FVector VertexB = FVector(Vertices[PolyIndex * 3 + 1].X, Vertices[PolyIndex * 3 + 1].Y, Vertices[PolyIndex * 3 + 1].Z);
-		FVector VertexC = FVector(Vertices[PolyIndex * 3 + 2].X, Vertices[PolyIndex * 3 + 2].Y, Vertices[PolyIndex * 3 + 2].Z);
+	SpanColumns.Init(0, 0, Width, Depth);
+	ResetOccupiedRows();
+}
 
-		PolyVertices.Add(VertexA);
-		PolyVertices.Add(VertexB);
-		PolyVertices.Add(VertexC);
+void USolidHeightfield::ReleaseSpans()
+{
+	SpanColumns.Init(0, 0, 0, 0);
+	ResetOccupiedRows();
+}
 
-		//Find the walkable polygons inside the mesh
-		PolygonType Type = FilterWalkablePolygon(PolyVertices);
+void USolidHeightfield::VoxelizeGeometry(const FVoxelGeometry& Geometry, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const
+{
+	if (Geometry.IsEmpty())
+	{
+		OutSpans.Init(0, 0, 0, 0);
+		return;
+	}
 
-		//Find the bounding box surrounding the triangle by comparing the vertices coordinates
-		//Default to the first vertex
-		FVector TriBoundsMin(VertexA.X, VertexA.Y, VertexA.Z);
-		FVector TriBoundsMax(VertexA.X, VertexA.Y, VertexA.Z);
+	//Find the grid area covered by the mesh, only the columns inside it are allocated
+	const FBox MeshBounds = Geometry.GetBounds();
 
-		for (int It = 0; It < 3; It++)
-		{
-			TriBoundsMin.X = FMath::Min(TriBoundsMin.X, PolyVertices[It].X);
-			TriBoundsMin.Y = FMath::Min(TriBoundsMin.Y, PolyVertices[It].Y);
-			TriBoundsMin.Z = FMath::Min(TriBoundsMin.Z, PolyVertices[It].Z);
+	const float InvertCellSize = 1 / CellSize;
+	int MeshWidthMin = FMath::Clamp(FMath::FloorToInt((MeshBounds.Min.X - Grid.BoundMin.X) * InvertCellSize), 0, Grid.Width);
+	int MeshWidthMax = FMath::Clamp(FMath::FloorToInt((MeshBounds.Max.X - Grid.BoundMin.X) * InvertCellSize), -1, Grid.Width - 1);
+	int MeshDepthMin = FMath::Clamp(FMath::FloorToInt((MeshBounds.Min.Y - Grid.BoundMin.Y) * InvertCellSize), 0, Grid.Depth);
+	int MeshDepthMax = FMath::Clamp(FMath::FloorToInt((MeshBounds.Max.Y - Grid.BoundMin.Y) * InvertCellSize), -1, Grid.Depth - 1);
 
-			TriBoundsMax.X = FMath::Max(TriBoundsMax.X, PolyVertices[It].X);
-			TriBoundsMax.Y = FMath::Max(TriBoundsMax.Y, PolyVertices[It].Y);
-			TriBoundsMax.Z = FMath::Max(TriBoundsMax.Z, PolyVertices[It].Z);
-		}
+	OutSpans.Init(MeshWidthMin, MeshDepthMin, MeshWidthMax - MeshWidthMin + 1, MeshDepthMax - MeshDepthMin + 1);
 
-		//Draw debug info relative to the polygon of the mesh  
-		/*UUtilityDebug::DrawMeshFaces(CurrentWorld, PolyVertices, FColor::Blue, 20, 1.0f);*/
-
-		//Draw debug info relative the the bounding box delimiting the polygon 
-		/*UUtilityDebug::DrawMinMaxBox(CurrentWorld, TriBoundsMin, TriBoundsMax, FColor::Red, 20.0f, 1.0f);*/
-
-		//Based on the bounding box data found, retrieve the width and depth and height covered by the cells inside it
-		int TriWidthMin = int((TriBoundsMin.X - BoundMin.X) * InvertCellSize);
-		int TriDepthMin = int((TriBoundsMin.Y - BoundMin.Y) * InvertCellSize);
-		int TriHeightMin = int((TriBoundsMin.Z - BoundMin.Z) * InvertCellHeight);
-		int TriWidthMax = int((TriBoundsMax.X - BoundMin.X) * InvertCellSize);
-		int TriDepthMax = int((TriBoundsMax.Y - BoundMin.Y) * InvertCellSize);
-		int TriHeightMax = int((TriBoundsMax.Z - BoundMin.Z) * InvertCellHeight);
-
-		//And make sure the cells are inside the bounds of the grid
-		TriWidthMin = FMath::Clamp(TriWidthMin, 0, Width - 1);
-		TriDepthMin = FMath::Clamp(TriDepthMin, 0, Depth - 1);
-		TriHeightMin = FMath::Clamp(TriHeightMin, 0, Height - 1);
-		TriWidthMax = FMath::Clamp(TriWidthMax, 0, Width - 1);
-		TriDepthMax = FMath::Clamp(TriDepthMax, 0, Depth - 1);
-		TriHeightMax = FMath::Clamp(TriHeightMax, 0, Height - 1);
-
-		//Loop through all the cells and find the clipped polygons from the base triangle contained inside each of them
-		//If the output number of vertices of the clipped polygon is less than 3 it is not a polygon and therefore the cell is invalid and can be ignored
-		TArray<FVector> ClippedPolygonVertices;
-		ClippedPolygonVertices.Reserve(9);
+	//The mesh is outside of the grid
+	if (OutSpans.Width == 0 || OutSpans.Depth == 0)
+	{
+		return;
+	}
 
+	if (Geometry.Vertices.Num() > 0)
+	{
 		//The height extension of the heightfield
-		float FieldHeight = SolidFieldMaxHeight - BoundMin.Z;
-
-		for (int DepthIndex = TriDepthMin; DepthIndex <= TriDepthMax; DepthIndex++)
-		{
-			for (int WidthIndex = TriWidthMin; WidthIndex <= TriWidthMax; ++WidthIndex)
-			{
-				//Find the min and max coord of each cell
-				FVector CellMinCoord = FVector(BoundMin.X + CellSize * WidthIndex, BoundMin.Y + CellSize * DepthIndex, SolidFieldMinHeight);
-				FVector CellMaxCoord = FVector(CellMinCoord.X + CellSize, CellMinCoord.Y + CellSize, SolidFieldMaxHeight);
+		float FieldHeight = MeshBounds.Max.Z - Grid.BoundMin.Z;
 
-				ClippedPolygonVertices = PolyVertices;
-				ClipPolygon(ClippedPolygonVertices, CellMinCoord, CellMaxCoord);
+		VoxelizeTriangles(Geometry.Vertices, Geometry.Indices, FieldHeight, Grid, OutSpans);
+	}
 
-				int ClippedVerticesNumber = ClippedPolygonVertices.Num();
-				if (ClippedVerticesNumber < 3)
-				{
-					continue;
-				}
+	for (const FBox& Box : Geometry.Boxes)
+	{
+		RasterizeBox(Box, Grid, OutSpans);
+	}
+}
 
-				//Draw debug info relative to the clipped polygon inside the cell
-				/*UUtilityDebug::DrawPolygon(CurrentWorld, ClippedPolygonVertices, FColor::Blue, 20.0f, 1.0f);*/
+void USolidHeightfield::VoxelizeTriangles(const TArray<FVector>& Vertices, const TArray<int>& Indices, const float FieldHeight, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const
+{
+	int PolyCount = Indices.Num() / 3;
 
-				//Based on the clipped vertex coordinates, find the z axis range for the cell
-				//Default value to the first vertex
-				float HeightMin = ClippedPolygonVertices[0].Z;
-				float HeightMax = ClippedPolygonVertices[0].Z;
+	//Compute the walkable type and the rows covered by every triangle before rasterizing them
+	TArray<FTriangleRasterData> TrianglesData;
+	TrianglesData.SetNumUninitialized(PolyCount);
 
-				for (int It = 1; It < ClippedVerticesNumber; It++)
-				{
-					HeightMin = FMath::Min(HeightMin, ClippedPolygonVertices[It].Z);
-					HeightMax = FMath::Max(HeightMax, ClippedPolygonVertices[It].Z);
-				}
+	//The vectorized slope test relies on the up normal being positive (MaxTraversableAngle <= 90)
+	if (EnableVectorization && UpNormal >= 0.f)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PrepareTrianglesVectorized);
 
-				// Convert to height above the base of the heightfield.
-				HeightMin -= BoundMin.Z;
-				HeightMax -= BoundMin.Z;
+		//Vertices of the batch stored as structure of arrays: AX, AY, AZ, BX, BY, BZ, CX, CY, CZ
+		alignas(16) float BatchVertices[9 * TRIANGLE_BATCH_SIZE];
 
-				// The height of the cell is entirely outside the bounds of the heightfield, skip the cell
-				if (HeightMax < 0.0f || HeightMin > FieldHeight)
-				{
-					continue;
-				}
+		for (int BatchStart = 0; BatchStart < PolyCount; BatchStart += TRIANGLE_BATCH_SIZE)
+		{
+			int BatchCount = FMath::Min(TRIANGLE_BATCH_SIZE, PolyCount - BatchStart);
 
-				//Make sure the height min and max are clamped to the bound of the bounding box  
-				if (HeightMin < 0.0f)
-				{
-					HeightMin = 0.0f;
-				}
+			for (int Lane = 0; Lane < TRIANGLE_BATCH_SIZE; Lane++)
+			{
+				//The last batch is filled by repeating its last triangle, the extra results are discarded
+				int PolyIndex = BatchStart + FMath::Min(Lane, BatchCount - 1);
 
-				if (HeightMax > FieldHeight)
+				for (int Corner = 0; Corner < 3; Corner++)
 				{
-					HeightMax = FieldHeight;
+					const FVector& Vertex = Vertices[Indices[PolyIndex * 3 + Corner]];
+					BatchVertices[(Corner * 3) * TRIANGLE_BATCH_SIZE + Lane] = Vertex.X;
+					BatchVertices[(Corner * 3 + 1) * TRIANGLE_BATCH_SIZE + Lane] = Vertex.Y;
+					BatchVertices[(Corner * 3 + 2) * TRIANGLE_BATCH_SIZE + Lane] = Vertex.Z;
 				}
+			}
 
-				//Conver the height coordinate data to voxel/grid data
-				int HeightIndexMin = FMath::Clamp(int(FMath::FloorToInt(HeightMin * InvertCellHeight)), 0, INT_MAX);
-				int HeightIndexMax = FMath::Clamp(int(FMath::CeilToInt(HeightMax * InvertCellHeight)), 0, INT_MAX);
-
-				AddSpanData(WidthIndex, DepthIndex, HeightIndexMin, HeightIndexMax, Type);
+			PrepareTriangleBatch(BatchVertices, BatchCount, Grid, &TrianglesData[BatchStart]);
+		}
+	}
+	else
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PrepareTrianglesScalar);
 
-				//Draw debug info relative to single valid cells
-				/*for (int It = HeightIndexMin; It <= HeightIndexMax; ++It)
-				{
-					FVector CellMinDebug = FVector(CellMinCoord.X, CellMinCoord.Y, BoundMin.Z + CellHeight * It);
-					FVector CellMaxDebug = FVector(CellMaxCoord.X, CellMaxCoord.Y, BoundMin.Z + CellHeight * It + CellHeight);
+		for (int PolyIndex = 0; PolyIndex < PolyCount; PolyIndex++)
+		{
+			//Find the vertices coordinates for every triangle of the mesh through the index buffer
+			const FVector& VertexA = Vertices[Indices[PolyIndex * 3]];
+			const FVector& VertexB = Vertices[Indices[PolyIndex * 3 + 1]];
+			const FVector& VertexC = Vertices[Indices[PolyIndex * 3 + 2]];
 
-					UUtilityDebug::DrawMinMaxBox(CurrentWorld, CellMinDebug, CellMaxDebug, FColor::Green, 20.0f, 0.5f);
-				}*/	
-			}
+			PrepareTriangle(VertexA, VertexB, VertexC, Grid, TrianglesData[PolyIndex]);
 		}
 	}
-}
 
-void USolidHeightfield::FindGeometryHeight(const TArray<FVector>& Vertices, float& MinHeight, float& MaxHeight)
-{
-	//Assign the bound min and max to the coordinates of the first vertex
-	MinHeight = Vertices[0].Z;
-	MaxHeight = Vertices[0].Z;
+	SCOPE_CYCLE_COUNTER(STAT_RasterizeTriangles);
 
-	//Iterate through all the vertices to find the actual bounds
-	for (FVector Vertex : Vertices)
+	for (int PolyIndex = 0; PolyIndex < PolyCount; PolyIndex++)
 	{
-		MinHeight = FMath::Min(Vertex.Z, MinHeight);
-		MaxHeight = FMath::Max(Vertex.Z, MaxHeight);
+		const FTriangleRasterData& TriangleData = TrianglesData[PolyIndex];
+
+		//The triangle does not touch the grid, nothing to rasterize
+		if (!TriangleData.OverlapsField)
+		{
+			continue;
+		}
+
+		const FVector& VertexA = Vertices[Indices[PolyIndex * 3]];
+		const FVector& VertexB = Vertices[Indices[PolyIndex * 3 + 1]];
+		const FVector& VertexC = Vertices[Indices[PolyIndex * 3 + 2]];
+
+		//Draw debug info relative to the polygon of the mesh  
+		/*UUtilityDebug::DrawMeshFaces(CurrentWorld, { VertexA, VertexB, VertexC }, FColor::Blue, 20, 1.0f);*/
+
+		RasterizeTriangle(VertexA, VertexB, VertexC, TriangleData, FieldHeight, Grid, OutSpans);
 	}
 }
 
-void USolidHeightfield::ClipVersusPlane(TArray<FVector>& Vertices, FVector MinBound, FVector MaxBound, BoxSide Side)
+void USolidHeightfield::VoxelizeTemplate(const FVoxelGeometry& Geometry, FVoxelTemplate& OutTemplate) const
 {
-	int VerticesNumber = Vertices.Num();
-
-	if (VerticesNumber < 3)
+	if (Geometry.IsEmpty())
 	{
-		//GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, TEXT("Insufficient number of vertices passed in, not a polygon, invalid cell"));
+		OutTemplate.Spans.Init(0, 0, 0, 0);
 		return;
 	}
 
-	int It_1 = 0;
-	int It_2 = 0;
-	TArray<FVector> VerticesOut;
+	//Find the cells covered by the mesh, the template grid starts at the cell containing its min bounds
+	const FBox MeshBounds = Geometry.GetBounds();
 
-	FVector	V0 = Vertices[0];
-	FVector V1 = Vertices[VerticesNumber - 1];
+	const FVector MeshBoundsMin = MeshBounds.Min;
+	const FVector MeshBoundsMax = MeshBounds.Max;
 
-	for (It_1 = 0; It_1 < VerticesNumber; It_1++)
-	{
-		V0 = Vertices[It_1];
-		
-		//Sutherland-Hodgeman Algorithm
-		//Check if the first point is inside the clipping plane 
-		if (InsideClippingPlane(V0, MinBound, MaxBound, Side))
-		{
-			//Check if the second point is outside the clipping plane
-			if (!InsideClippingPlane(V1, MinBound, MaxBound, Side))
-			{
-				//The second point is outside while the first is inside:
-				//The intersection point of the line defining the clipping plane should be included in the output, followed by the first point
-				FVector Intersection = FindPlaneIntersection(V0, V1, MinBound, MaxBound, Side) ;
-				SetArrayElement(VerticesOut, Intersection, It_2);
-				It_2++;
-			}
+	int CellMinWidth = FMath::FloorToInt(MeshBoundsMin.X / CellSize);
+	int CellMinDepth = FMath::FloorToInt(MeshBoundsMin.Y / CellSize);
+	int CellMinHeight = FMath::FloorToInt(MeshBoundsMin.Z / CellHeight);
 
-			//If both of the points are inside, only the first one is added to the output
-			SetArrayElement(VerticesOut, V0, It_2);
-			It_2++;
-		}
-		//If the first point is outside, check if the second one is inside
-		else if (InsideClippingPlane(V1, MinBound, MaxBound, Side))
-		{
-			//If it is the intersection of the line defining the clipping plane should be included in the output
-			FVector Intersection = FindPlaneIntersection(V1, V0, MinBound, MaxBound, Side);
-			SetArrayElement(VerticesOut, Intersection, It_2);
-			It_2++;
-		}
+	FVoxelGrid TemplateGrid;
+	TemplateGrid.BoundMin = FVector(CellMinWidth * CellSize, CellMinDepth * CellSize, CellMinHeight * CellHeight);
+	TemplateGrid.Width = FMath::FloorToInt(MeshBoundsMax.X / CellSize) - CellMinWidth + 1;
+	TemplateGrid.Depth = FMath::FloorToInt(MeshBoundsMax.Y / CellSize) - CellMinDepth + 1;
+	TemplateGrid.BoundMax = TemplateGrid.BoundMin + FVector(TemplateGrid.Width * CellSize, TemplateGrid.Depth * CellSize, MeshBoundsMax.Z - TemplateGrid.BoundMin.Z);
 
-		//If both of the ponits are outside, nothing is added to the output polygon
-		V1 = V0;
-	}
+	VoxelizeGeometry(Geometry, TemplateGrid, OutTemplate.Spans);
 
-	Vertices = VerticesOut;
+	//Express the columns location in cells from the origin of the local space
+	OutTemplate.Spans.OffsetWidth += CellMinWidth;
+	OutTemplate.Spans.OffsetDepth += CellMinDepth;
+	OutTemplate.OffsetHeight = CellMinHeight;
 }
 
-void USolidHeightfield::ClipPolygon(TArray<FVector>& Vertices, const FVector MinBound, const FVector MaxBound)
+void USolidHeightfield::RasterizeBox(const FBox& Box, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const
 {
-	if (Vertices.Num() > 0)
+	//The box does not touch the grid, nothing to rasterize
+	if (Box.Max.X < Grid.BoundMin.X || Box.Min.X > Grid.BoundMax.X || Box.Max.Y < Grid.BoundMin.Y || Box.Min.Y > Grid.BoundMax.Y)
 	{
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::LEFT_FACE);
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::RIGHT_FACE);
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::TOP_FACE);
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::BOTTOM_FACE);
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::FRONT_FACE);
-		ClipVersusPlane(Vertices, MinBound, MaxBound, BoxSide::BACK_FACE);
+		return;
 	}
-}
 
-int USolidHeightfield::InsideClippingPlane(const FVector Vertex, const FVector MinBound, const FVector MaxBound, const BoxSide Side)
-{
-	//Check if the point is inside the bounds delimited by every plane
-	//For each plane we only care about the coordinate of the axis perpendicular to it
-	switch (Side)
+	const float InvertCellSize = 1 / CellSize;
+	const float InvertCellHeight = 1 / CellHeight;
+
+	//Convert to height above the base of the heightfield, same as the triangles
+	float HeightMin = Box.Min.Z - Grid.BoundMin.Z;
+	float HeightMax = Box.Max.Z - Grid.BoundMin.Z;
+
+	if (HeightMax < 0.0f)
 	{
-	case BoxSide::LEFT_FACE:
-		return Vertex.Y >= MinBound.Y;
+		return;
+	}
 
-	case BoxSide::RIGHT_FACE:
-		return Vertex.Y <= MaxBound.Y;
+	HeightMin = FMath::Max(HeightMin, 0.0f);
 
-	case BoxSide::TOP_FACE:
-		return Vertex.Z <= MaxBound.Z;
+	int HeightIndexMin = FMath::FloorToInt(HeightMin * InvertCellHeight);
+	int HeightIndexMax = FMath::CeilToInt(HeightMax * InvertCellHeight);
 
-	case BoxSide::BOTTOM_FACE:
-		return Vertex.Z >= MinBound.Z;
+	int WidthMin = FMath::Clamp(FMath::FloorToInt((Box.Min.X - Grid.BoundMin.X) * InvertCellSize), 0, Grid.Width - 1);
+	int WidthMax = FMath::Clamp(FMath::FloorToInt((Box.Max.X - Grid.BoundMin.X) * InvertCellSize), 0, Grid.Width - 1);
+	int DepthMin = FMath::Clamp(FMath::FloorToInt((Box.Min.Y - Grid.BoundMin.Y) * InvertCellSize), 0, Grid.Depth - 1);
+	int DepthMax = FMath::Clamp(FMath::FloorToInt((Box.Max.Y - Grid.BoundMin.Y) * InvertCellSize), 0, Grid.Depth - 1);
 
-	case BoxSide::FRONT_FACE:
-		return Vertex.X >= MinBound.X;
+	//The top face of the box is flat, so its walkability only depends on the max slope allowed
+	const uint8 Area = (1.f > UpNormal) ? WALKABLE_AREA : NULL_AREA;
 
-	case BoxSide::BACK_FACE:
-		return Vertex.X <= MaxBound.X;
+	for (int DepthIndex = DepthMin; DepthIndex <= DepthMax; DepthIndex++)
+	{
+		for (int WidthIndex = WidthMin; WidthIndex <= WidthMax; WidthIndex++)
+		{
+			OutSpans.AddSpan(WidthIndex, DepthIndex, HeightIndexMin, HeightIndexMax, Area);
+		}
 	}
-
-	return -1;
 }
 
-FVector USolidHeightfield::FindPlaneIntersection(const FVector V0, const FVector V1, const FVector MinBound, const FVector MaxBound, const BoxSide Side)
+void USolidHeightfield::PrepareTriangle(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC, const FVoxelGrid& Grid, FTriangleRasterData& OutData) const
 {
-	FVector IntersectionPoint(0.f, 0.f, 0.f);
-	FVector PlaneOrigin(0.f, 0.f, 0.f);
+	const float InvertCellSize = 1 / CellSize;
 
-	float CenterX = (MaxBound.X + MinBound.X) / 2;
-	float CenterY = (MaxBound.Y + MinBound.Y) / 2;
-	float CenterZ = (MaxBound.Z + MinBound.Z) / 2;
+	//Find the walkable polygons inside the mesh
+	OutData.Area = FilterWalkablePolygon(VertexA, VertexB, VertexC);
 
-	//Retrieve the origin coordinates of every plane based on the side considered and find the intersection point
-	//The normals can be easily found because the box is axis aligned
-	switch (Side)
-	{
-	case BoxSide::LEFT_FACE:
-		PlaneOrigin = FVector(CenterX, MinBound.Y, CenterZ);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(0.0f, -1.0f, 0.0f));
-		break;
-
-	case BoxSide::RIGHT_FACE:
-		PlaneOrigin = FVector(CenterX, MaxBound.Y, CenterZ);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(0.0f, 1.0f, 0.0f));
-		break;
-
-	case BoxSide::TOP_FACE:
-		PlaneOrigin = FVector(CenterX, CenterY, MaxBound.Z);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(0.0f, 0.0f, 1.0f));
-		break;
-
-	case BoxSide::BOTTOM_FACE:
-		PlaneOrigin = FVector(CenterX, CenterY, MinBound.Z);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(0.0f, 0.0f, -1.0f));
-		break;
-
-	case BoxSide::FRONT_FACE:
-		PlaneOrigin = FVector(MinBound.X, CenterY, CenterZ);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(-1.0f, 0.0f, 0.0f));
-		break;
-
-	case BoxSide::BACK_FACE:
-		PlaneOrigin = FVector(MaxBound.X, CenterY, CenterZ);
-		IntersectionPoint = FMath::LinePlaneIntersection(V0, V1, PlaneOrigin, FVector(1.0f, 0.0f, 0.0f));
-		break;
-
-	//Default case to make sure to notify if no intersection is found
-	default:
-		GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, TEXT("No line-plane intersection found"));
-		break;
-	}
+	//Find the bounding box surrounding the triangle by comparing the vertices coordinates
+	FVector TriBoundsMin = VertexA.ComponentMin(VertexB).ComponentMin(VertexC);
+	FVector TriBoundsMax = VertexA.ComponentMax(VertexB).ComponentMax(VertexC);
+
+	//Draw debug info relative the the bounding box delimiting the polygon 
+	/*UUtilityDebug::DrawMinMaxBox(CurrentWorld, TriBoundsMin, TriBoundsMax, FColor::Red, 20.0f, 1.0f);*/
 
-	return IntersectionPoint;
+	OutData.OverlapsField = !(TriBoundsMax.X < Grid.BoundMin.X || TriBoundsMin.X > Grid.BoundMax.X || TriBoundsMax.Y < Grid.BoundMin.Y || TriBoundsMin.Y > Grid.BoundMax.Y);
+
+	//Based on the bounding box data found, retrieve the depth covered by the cells inside it
+	//The row before the grid is kept (-1) so that the part of the triangle outside of it is split off and discarded
+	OutData.DepthMin = FMath::Clamp(FMath::FloorToInt((TriBoundsMin.Y - Grid.BoundMin.Y) * InvertCellSize), -1, Grid.Depth - 1);
+	OutData.DepthMax = FMath::Clamp(FMath::FloorToInt((TriBoundsMax.Y - Grid.BoundMin.Y) * InvertCellSize), -1, Grid.Depth - 1);
 }
 
-PolygonType USolidHeightfield::FilterWalkablePolygon(const TArray<FVector>& Vertices)
+void USolidHeightfield::PrepareTriangleBatch(const float* BatchVertices, const int BatchCount, const FVoxelGrid& Grid, FTriangleRasterData* OutData) const
 {
-	FVector DiffAB = Vertices[1] - Vertices[0];
-	FVector DiffAC = Vertices[2] - Vertices[0];
-
-	FVector Result = FVector::CrossProduct(DiffAC, DiffAB);
-	Result.Normalize();
-	
-	//Unreal uses the Z as up axis
-    if (Result.Z > UpNormal)
+	const VectorRegister AX = VectorLoadAligned(BatchVertices + 0 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister AY = VectorLoadAligned(BatchVertices + 1 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister AZ = VectorLoadAligned(BatchVertices + 2 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister BX = VectorLoadAligned(BatchVertices + 3 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister BY = VectorLoadAligned(BatchVertices + 4 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister BZ = VectorLoadAligned(BatchVertices + 5 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister CX = VectorLoadAligned(BatchVertices + 6 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister CY = VectorLoadAligned(BatchVertices + 7 * TRIANGLE_BATCH_SIZE);
+	const VectorRegister CZ = VectorLoadAligned(BatchVertices + 8 * TRIANGLE_BATCH_SIZE);
+
+	//Slope test, same cross product used by FilterWalkablePolygon (AC x AB)
+	//The normal is not normalized, the test Normal.Z / |Normal| > UpNormal is performed on the squared values instead
+	const VectorRegister ABX = VectorSubtract(BX, AX);
+	const VectorRegister ABY = VectorSubtract(BY, AY);
+	const VectorRegister ABZ = VectorSubtract(BZ, AZ);
+	const VectorRegister ACX = VectorSubtract(CX, AX);
+	const VectorRegister ACY = VectorSubtract(CY, AY);
+	const VectorRegister ACZ = VectorSubtract(CZ, AZ);
+
+	const VectorRegister NormalX = VectorSubtract(VectorMultiply(ACY, ABZ), VectorMultiply(ACZ, ABY));
+	const VectorRegister NormalY = VectorSubtract(VectorMultiply(ACZ, ABX), VectorMultiply(ACX, ABZ));
+	const VectorRegister NormalZ = VectorSubtract(VectorMultiply(ACX, ABY), VectorMultiply(ACY, ABX));
+
+	const VectorRegister NormalSizeSquared = VectorMultiplyAdd(NormalX, NormalX, VectorMultiplyAdd(NormalY, NormalY, VectorMultiply(NormalZ, NormalZ)));
+	const VectorRegister UpNormalSquared = VectorSetFloat1(UpNormal * UpNormal);
+
+	const int WalkableMask = VectorMaskBits(VectorBitwiseAnd(
+		VectorCompareGT(NormalZ, VectorZero()),
+		VectorCompareGT(VectorMultiply(NormalZ, NormalZ), VectorMultiply(UpNormalSquared, NormalSizeSquared))));
+
+	//Bounds of the triangles on the grid plane
+	const VectorRegister TriMinX = VectorMin(VectorMin(AX, BX), CX);
+	const VectorRegister TriMinY = VectorMin(VectorMin(AY, BY), CY);
+	const VectorRegister TriMaxX = VectorMax(VectorMax(AX, BX), CX);
+	const VectorRegister TriMaxY = VectorMax(VectorMax(AY, BY), CY);
+
+	const VectorRegister FieldMinX = VectorSetFloat1(Grid.BoundMin.X);
+	const VectorRegister FieldMinY = VectorSetFloat1(Grid.BoundMin.Y);
+	const VectorRegister FieldMaxX = VectorSetFloat1(Grid.BoundMax.X);
+	const VectorRegister FieldMaxY = VectorSetFloat1(Grid.BoundMax.Y);
+
+	const int OutsideMask = VectorMaskBits(VectorBitwiseOr(
+		VectorBitwiseOr(VectorCompareGT(FieldMinX, TriMaxX), VectorCompareGT(TriMinX, FieldMaxX)),
+		VectorBitwiseOr(VectorCompareGT(FieldMinY, TriMaxY), VectorCompareGT(TriMinY, FieldMaxY))));
+
+	//Quantize the rows covered by the triangles, clamped to [-1, Depth - 1] as in PrepareTriangle
+	//The values are shifted by one before the conversion so that the truncation behaves as a floor
+	const VectorRegister InvertCellSize = VectorSetFloat1(1 / CellSize);
+	const VectorRegister MinRow = VectorSetFloat1(-1.f);
+	const VectorRegister MaxRow = VectorSetFloat1(float(Grid.Depth - 1));
+	const VectorRegister One = VectorSetFloat1(1.f);
+
+	const VectorRegister RowMin = VectorMin(VectorMax(VectorMultiply(VectorSubtract(TriMinY, FieldMinY), InvertCellSize), MinRow), MaxRow);
+	const VectorRegister RowMax = VectorMin(VectorMax(VectorMultiply(VectorSubtract(TriMaxY, FieldMinY), InvertCellSize), MinRow), MaxRow);
+
+	alignas(16) int32 DepthMin[TRIANGLE_BATCH_SIZE];
+	alignas(16) int32 DepthMax[TRIANGLE_BATCH_SIZE];
+	VectorIntStoreAligned(VectorFloatToInt(VectorAdd(RowMin, One)), DepthMin);
+	VectorIntStoreAligned(VectorFloatToInt(VectorAdd(RowMax, One)), DepthMax);
+
+	for (int Lane = 0; Lane < BatchCount; Lane++)
 	{
-		return PolygonType::WALKABLE;
+		FTriangleRasterData& TriangleData = OutData[Lane];
+		TriangleData.Area = (WalkableMask & (1 << Lane)) ? WALKABLE_AREA : NULL_AREA;
+		TriangleData.OverlapsField = (OutsideMask & (1 << Lane)) == 0;
+		TriangleData.DepthMin = DepthMin[Lane] - 1;
+		TriangleData.DepthMax = DepthMax[Lane] - 1;
 	}
-
-	return PolygonType::UNWALKABLE;
 }
 
-void USolidHeightfield::CalculateUpNormal()
+void USolidHeightfield::RasterizeTriangle(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC, const FTriangleRasterData& TriangleData, const float FieldHeight, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const
 {
-	float SlopeToRadians = FMath::Abs(MaxTraversableAngle / 180.f * PI);
-	UpNormal =FMath::Cos(SlopeToRadians);
+	const float InvertCellSize = 1 / CellSize;
+	const float InvertCellHeight = 1 / CellHeight;
+	const uint8 Area = TriangleData.Area;
 
-	//GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, FString::SanitizeFloat(UpNormal));
-}
+	//Fixed size buffers used while splitting the triangle, clipping it against the 4 sides of a cell generates at most 7 vertices
+	FVector Buffer[MAX_CLIPPED_VERTICES * 4];
+	FVector* RemainingPoly = Buffer;
+	FVector* RowPoly = Buffer + MAX_CLIPPED_VERTICES;
+	FVector* CellPoly = Buffer + MAX_CLIPPED_VERTICES * 2;
+	FVector* SplitPoly = Buffer + MAX_CLIPPED_VERTICES * 3;
 
-bool USolidHeightfield::AddSpanData(int WidthIndex, int DepthIndex, int HeightIndexMin, int HeightIndexMax, PolygonType Type)
-{
-	//Check the boundaries of cells passed in and ignore them if they exceed them
-	if (WidthIndex < 0 || WidthIndex >= Width || DepthIndex < 0 || DepthIndex >= Depth)
-	{
-		return false;
-	}
+	RemainingPoly[0] = VertexA;
+	RemainingPoly[1] = VertexB;
+	RemainingPoly[2] = VertexC;
+	int RemainingCount = 3;
 
-	if (HeightIndexMin < 0 || HeightIndexMax < 0 || HeightIndexMin > HeightIndexMax)
+	for (int DepthIndex = TriangleData.DepthMin; DepthIndex <= TriangleData.DepthMax; DepthIndex++)
 	{
-		return false;
-	}
+		//Split the part of the polygon contained inside the row from the remaining one, which is processed in the next rows
+		const float RowMaxCoord = Grid.BoundMin.Y + CellSize * (DepthIndex + 1);
 
-	//Initialize a new span data with the parameters passed in to the function
-	UHeightSpan* NewSpan = NewObject<UHeightSpan>(UHeightSpan::StaticClass());
-	NewSpan->Min = HeightIndexMin;
-	NewSpan->Max = HeightIndexMax;
-	NewSpan->Width = WidthIndex;
-	NewSpan->Depth = DepthIndex;
-	NewSpan->SpanAttribute = Type;
+		int RowCount = 0;
+		DividePolygon(RemainingPoly, RemainingCount, RowPoly, RowCount, SplitPoly, RemainingCount, RowMaxCoord, 1);
+		Swap(RemainingPoly, SplitPoly);
 
-	//If the grid location contains no data, generate a new span and add it to the container
-	int GridIndex = GetGridIndex(WidthIndex, DepthIndex);
+		//If the output number of vertices of the polygon is less than 3 it is not a polygon and therefore the row can be ignored
+		if (RowCount < 3 || DepthIndex < 0)
+		{
+			continue;
+		}
 
-	if (!Spans.Contains(GridIndex))
-	{
-		Spans.Add(GridIndex, NewSpan);
-		return true;
-	}
+		//Find the horizontal bounds of the polygon inside the row
+		float RowMinX = RowPoly[0].X;
+		float RowMaxX = RowPoly[0].X;
 
-	// If a span data already exists, search the spans in the column to see which one should contain this span
-	//or if a new span should be created
-	UHeightSpan* CurrentSpan = *Spans.Find(GridIndex);
-	UHeightSpan* PreviousSpan = nullptr;
-	while (CurrentSpan)
-	{
-		//Check if the new span is below the current span
-		if (CurrentSpan->Min > HeightIndexMax + 1)
+		for (int It = 1; It < RowCount; It++)
+		{
+			RowMinX = FMath::Min(RowMinX, RowPoly[It].X);
+			RowMaxX = FMath::Max(RowMaxX, RowPoly[It].X);
+		}
+
+		int TriWidthMin = FMath::Clamp(FMath::FloorToInt((RowMinX - Grid.BoundMin.X) * InvertCellSize), -1, Grid.Width - 1);
+		int TriWidthMax = FMath::Clamp(FMath::FloorToInt((RowMaxX - Grid.BoundMin.X) * InvertCellSize), -1, Grid.Width - 1);
+
+		for (int WidthIndex = TriWidthMin; WidthIndex <= TriWidthMax; ++WidthIndex)
 		{
-			//If it is, create a new span and insert it below the current span
-			NewSpan->nextSpan = CurrentSpan;
+			//Same as above, split the part of the row polygon contained inside the cell
+			const float CellMaxCoord = Grid.BoundMin.X + CellSize * (WidthIndex + 1);
+
+			int CellCount = 0;
+			DividePolygon(RowPoly, RowCount, CellPoly, CellCount, SplitPoly, RowCount, CellMaxCoord, 0);
+			Swap(RowPoly, SplitPoly);
 
-			//If the new span is the first one in this column, insert it at the base
-			if (!PreviousSpan)
+			if (CellCount < 3 || WidthIndex < 0)
 			{
-				Spans.Add(GridIndex, NewSpan);
+				continue;
 			}
 
-			//If the new span is between 2 spans, link the previous span to the new one
-			else
+			//Draw debug info relative to the clipped polygon inside the cell
+			/*UUtilityDebug::DrawPolygon(CurrentWorld, TArray<FVector>(CellPoly, CellCount), FColor::Blue, 20.0f, 1.0f);*/
+
+			//Based on the clipped vertex coordinates, find the z axis range for the cell
+			//Default value to the first vertex
+			float HeightMin = CellPoly[0].Z;
+			float HeightMax = CellPoly[0].Z;
+
+			for (int It = 1; It < CellCount; It++)
 			{
-				PreviousSpan->nextSpan = NewSpan;
+				HeightMin = FMath::Min(HeightMin, CellPoly[It].Z);
+				HeightMax = FMath::Max(HeightMax, CellPoly[It].Z);
 			}
 
-			return true;
-		}
+			// Convert to height above the base of the heightfield.
+			HeightMin -= Grid.BoundMin.Z;
+			HeightMax -= Grid.BoundMin.Z;
 
-		//Current span is below the new span
-		else if (CurrentSpan->Max < HeightIndexMin - 1)
-		{
-			//Current span is not adjacent to new span
-			if (!CurrentSpan->nextSpan)
+			// The height of the cell is entirely outside the bounds of the heightfield, skip the cell
+			if (HeightMax < 0.0f || HeightMin > FieldHeight)
+			{
+				continue;
+			}
+
+			//Make sure the height min and max are clamped to the bound of the bounding box  
+			if (HeightMin < 0.0f)
 			{
-				//Locate the new span above the current one
-				CurrentSpan->nextSpan = NewSpan;
+				HeightMin = 0.0f;
+			}
 
-				return true;
+			if (HeightMax > FieldHeight)
+			{
+				HeightMax = FieldHeight;
 			}
 
-			PreviousSpan = CurrentSpan;
-			CurrentSpan = CurrentSpan->nextSpan;
+			//Conver the height coordinate data to voxel/grid data
+			int HeightIndexMin = FMath::Clamp(int(FMath::FloorToInt(HeightMin * InvertCellHeight)), 0, INT_MAX);
+			int HeightIndexMax = FMath::Clamp(int(FMath::CeilToInt(HeightMax * InvertCellHeight)), 0, INT_MAX);
+
+			OutSpans.AddSpan(WidthIndex, DepthIndex, HeightIndexMin, HeightIndexMax, Area);
+
+			//Draw debug info relative to single valid cells
+			/*for (int It = HeightIndexMin; It <= HeightIndexMax; ++It)
+			{
+				FVector CellMinDebug = FVector(CellMaxCoord - CellSize, RowMaxCoord - CellSize, Grid.BoundMin.Z + CellHeight * It);
+				FVector CellMaxDebug = FVector(CellMaxCoord, RowMaxCoord, Grid.BoundMin.Z + CellHeight * It + CellHeight);
+
+				UUtilityDebug::DrawMinMaxBox(CurrentWorld, CellMinDebug, CellMaxDebug, FColor::Green, 20.0f, 0.5f);
+			}*/	
 		}
+	}
+}
 
-		//There's overlap or adjacency between new and current span, merge is needed
-		else
+void USolidHeightfield::DividePolygon(const FVector* InVertices, const int InCount, FVector* OutVertices1, int& OutCount1, FVector* OutVertices2, int& OutCount2, const float AxisOffset, const int Axis) const
+{
+	//Signed distance of every vertex from the dividing line
+	float Distance[MAX_CLIPPED_VERTICES];
+	for (int It = 0; It < InCount; It++)
+	{
+		Distance[It] = AxisOffset - InVertices[It][Axis];
+	}
+
+	int Count1 = 0;
+	int Count2 = 0;
+
+	for (int It_1 = 0, It_2 = InCount - 1; It_1 < InCount; It_2 = It_1, It_1++)
+	{
+		bool InsideA = Distance[It_2] >= 0;
+		bool InsideB = Distance[It_1] >= 0;
+
+		//The edge crosses the dividing line, the intersection point belongs to both polygons
+		if (InsideA != InsideB)
 		{
-			if (HeightIndexMin < CurrentSpan->Min)
+			float Ratio = Distance[It_2] / (Distance[It_2] - Distance[It_1]);
+			OutVertices1[Count1] = InVertices[It_2] + (InVertices[It_1] - InVertices[It_2]) * Ratio;
+			OutVertices2[Count2] = OutVertices1[Count1];
+			Count1++;
+			Count2++;
+
+			//Add the current vertex to the polygon on its side
+			//Vertices on the dividing line are skipped as they have been already added above
+			if (Distance[It_1] > 0)
 			{
-				//Base on the condition above, set the new height min of the current span
-				CurrentSpan->SetMinHeight(HeightIndexMin);
+				OutVertices1[Count1] = InVertices[It_1];
+				Count1++;
 			}
-
-			if (HeightIndexMax == CurrentSpan->Max)
+			else if (Distance[It_1] < 0)
 			{
-				//Base on the condition above, merge the span type
-				CurrentSpan->SpanAttribute = Type;
-				return true;
+				OutVertices2[Count2] = InVertices[It_1];
+				Count2++;
 			}
+		}
 
-			if (CurrentSpan->Max > HeightIndexMax)
+		//Both vertices on the same side, add the current one to the polygon on that side
+		//Vertices laying on the dividing line are added to both
+		else
+		{
+			if (Distance[It_1] >= 0)
 			{
-				//Current span is higher than new one, no need to preform any action, current one takes priority
-				return true;
-			}
+				OutVertices1[Count1] = InVertices[It_1];
+				Count1++;
 
-			//If all the condition above are skipped, the new spans's maximum height is higher than the current span's maximum height
-			//Need to check where the merge ends
-			UHeightSpan* NextSpan = CurrentSpan->nextSpan;
-			while (true)
-			{		
-				if (NextSpan == nullptr || NextSpan->Min > HeightIndexMax + 1)
+				if (Distance[It_1] != 0)
 				{
-					//If there are no spans above the current one or the height increase does not affect the next span
-					//the current span max and type can be directly replaced and set
-					CurrentSpan->SetMaxHeight(HeightIndexMax);
-					CurrentSpan->SpanAttribute = Type;
+					continue;
+				}
+			}
 
-					//If current span at top of the column, remove any possible link it could have had
-					if (NextSpan == nullptr)
-					{
-						CurrentSpan->nextSpan = nullptr;
-					}
-					else
-					{
-						CurrentSpan->nextSpan = NextSpan;
-					}
+			OutVertices2[Count2] = InVertices[It_1];
+			Count2++;
+		}
+	}
 
-					return true;
-				}
+	OutCount1 = Count1;
+	OutCount2 = Count2;
+}
 
-				//The new height of the current span is overlapping with another span, merging needed
-				//If no gap between current and next span and no overlap as well
-				if (NextSpan->Min == HeightIndexMax + 1 || HeightIndexMax <= NextSpan->Max)
-				{
-					CurrentSpan->SetMaxHeight(NextSpan->Max);
-					CurrentSpan->nextSpan = NextSpan->nextSpan;
-					CurrentSpan->SpanAttribute = NextSpan->SpanAttribute;
+uint8 USolidHeightfield::FilterWalkablePolygon(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC) const
+{
+	FVector DiffAB = VertexB - VertexA;
+	FVector DiffAC = VertexC - VertexA;
 
-					//If the new span has the same height of the current ne, merge the attribute
-					if (HeightIndexMax == CurrentSpan->Max)
-					{
-						CurrentSpan->SpanAttribute = Type;
-						return true;
-					}
+	FVector Result = FVector::CrossProduct(DiffAC, DiffAB);
+	Result.Normalize();
+	
+	//Unreal uses the Z as up axis
+    if (Result.Z > UpNormal)
+	{
+		return WALKABLE_AREA;
+	}
 
-					return true;
-				}
+	return NULL_AREA;
+}
 
-				//The current span overlaps the next one, go up in the column to see when the next will be fully included
-				NextSpan = NextSpan->nextSpan;
-			}
-		}
+void USolidHeightfield::CalculateUpNormal()
+{
+	float SlopeToRadians = FMath::Abs(MaxTraversableAngle / 180.f * PI);
+	UpNormal =FMath::Cos(SlopeToRadians);
+
+	//GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, FString::SanitizeFloat(UpNormal));
+}
+
+FVoxelGrid USolidHeightfield::GetFieldGrid() const
+{
+	FVoxelGrid Grid;
+	Grid.BoundMin = BoundMin;
+	Grid.BoundMax = BoundMax;
+	Grid.Width = Width;
+	Grid.Depth = Depth;
+
+	return Grid;
+}
+
+bool USolidHeightfield::AddSpanData(int WidthIndex, int DepthIndex, int HeightIndexMin, int HeightIndexMax, uint8 Area)
+{
+	if (!SpanColumns.AddSpan(WidthIndex, DepthIndex, HeightIndexMin, HeightIndexMax, Area))
+	{
+		return false;
 	}
 
-	//Error in the span calculation
-	return false;
+	MarkOccupiedCells(WidthIndex, DepthIndex, WidthIndex, DepthIndex);
+	return true;
+}
+
+void USolidHeightfield::MergeSpans(const FHeightSpanColumns& MeshSpans)
+{
+	SpanColumns.Merge(MeshSpans);
+
+	//The whole area of the mesh is marked, the empty columns inside it are skipped quickly anyway
+	MarkOccupiedCells(MeshSpans.OffsetWidth, MeshSpans.OffsetDepth, MeshSpans.OffsetWidth + MeshSpans.Width - 1, MeshSpans.OffsetDepth + MeshSpans.Depth - 1);
+}
+
+void USolidHeightfield::MergeTemplate(const FVoxelTemplate& Template, const FIntVector& Cell, const int QuarterTurns)
+{
+	const FHeightSpanColumns& Spans = Template.Spans;
+	SpanColumns.MergeTransformed(Spans, Cell.X, Cell.Y, Cell.Z + Template.OffsetHeight, QuarterTurns);
+
+	if (Spans.Width == 0 || Spans.Depth == 0)
+	{
+		return;
+	}
+
+	//Rotate the corners of the template area in the same way of MergeTransformed to find the area covered in the grid
+	FIntPoint CornerMin(Spans.OffsetWidth, Spans.OffsetDepth);
+	FIntPoint CornerMax(Spans.OffsetWidth + Spans.Width - 1, Spans.OffsetDepth + Spans.Depth - 1);
+
+	for (int It = 0; It < (QuarterTurns & 0x03); It++)
+	{
+		FIntPoint RotatedMin(-CornerMax.Y - 1, CornerMin.X);
+		FIntPoint RotatedMax(-CornerMin.Y - 1, CornerMax.X);
+		CornerMin = RotatedMin;
+		CornerMax = RotatedMax;
+	}
+
+	MarkOccupiedCells(CornerMin.X + Cell.X, CornerMin.Y + Cell.Y, CornerMax.X + Cell.X, CornerMax.Y + Cell.Y);
 }
 
 void USolidHeightfield::DrawDebugSpanData()
 {
-	//Iterate through all the cells
-	for (int i = 0; i < Depth; i++)
+	//Iterate through all the cells, the columns can be released (or cover a single chunk) after the build
+	for (int i = 0; i < SpanColumns.Depth; i++)
 	{
-		for (int j = 0; j < Width; j++)
+		for (int j = 0; j < SpanColumns.Width; j++)
 		{
-			//Find the index of each span and make sure the index exist before accessing the map element
-			int SpanIndex = i * Width + j;
+			//Find the base span of each column and make sure the column is not empty
+			uint32 CurrentIndex = SpanColumns.Columns[i * SpanColumns.Width + j];
 
-			if (Spans.Contains(SpanIndex))
+			if (CurrentIndex != NULL_SPAN)
 			{
-				UHeightSpan* Span = *Spans.Find(SpanIndex);
-
 				do {
+					const FHeightSpan& Span = SpanColumns.Pool[CurrentIndex];
+
 					//Retrieve the location value of every span based on the bounds and the width and depth coordinates
-					FVector SpanMinCoord = FVector(BoundMin.X + CellSize * j, BoundMin.Y + CellSize * i, BoundMin.Z + CellHeight * Span->Min);
-					FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize, SpanMinCoord.Y + CellSize, BoundMin.Z + CellHeight * Span->Max);
+					FVector SpanMinCoord = FVector(BoundMin.X + CellSize * j, BoundMin.Y + CellSize * i, BoundMin.Z + CellHeight * Span.Min);
+					FVector SpanMaxCoord = FVector(SpanMinCoord.X + CellSize, SpanMinCoord.Y + CellSize, BoundMin.Z + CellHeight * Span.Max);
 					FColor SpanLineColor;
 
 					//Mark the spans with different colors based on their type
-					if (Span->SpanAttribute == PolygonType::WALKABLE)
+					if (Span.Area != NULL_AREA)
 					{
 						SpanLineColor = FColor::Green;
 					}
@@ -540,66 +657,113 @@ void USolidHeightfield::DrawDebugSpanData()
 					}
 					UUtilityDebug::DrawMinMaxBox(CurrentWorld, SpanMinCoord, SpanMaxCoord, SpanLineColor, 20.0f, 2.f);
 
-					Span = Span->nextSpan;
+					CurrentIndex = Span.NextSpan;
 
-				} while (Span);
+				} while (CurrentIndex != NULL_SPAN);
 			}
 		}
 	}
 }
 
-void USolidHeightfield::MarkLowHeightSpan()
+void USolidHeightfield::FilterSpans()
 {
-	//Iterate through all the base span
-	for (auto& Span : Spans)
+	SCOPE_CYCLE_COUNTER(STAT_FilterSolidSpans);
+
+	//Spans that have to be flagged as unwalkable, indexed as the span pool
+	//The filters only read the heightfield, so every row can be processed on a different thread
+	TArray<bool> UnwalkableSpans;
+	UnwalkableSpans.Init(false, SpanColumns.Pool.GetCapacity());
+
+	//Only the rows containing spans are processed
+	ParallelFor(FMath::Max(OccupiedDepthMax - OccupiedDepthMin + 1, 0), [&](int32 It)
 	{
-		//As long as the current span has a next span valid
-		UHeightSpan* CurrentSpan = Span.Value;
+		int DepthIndex = OccupiedDepthMin + It;
+
+		MarkLowHeightSpan(DepthIndex, UnwalkableSpans);
+		MarkLedgeSpan(DepthIndex, UnwalkableSpans);
+	});
+
+	//Apply the result of the filters once all the rows have been processed
+	for (int SpanIndex = 0; SpanIndex < UnwalkableSpans.Num(); SpanIndex++)
+	{
+		if (UnwalkableSpans[SpanIndex])
+		{
+			SpanColumns.Pool[SpanIndex].Area = NULL_AREA;
+		}
+	}
+}
+
+void USolidHeightfield::MarkLowHeightSpan(const int DepthIndex, TArray<bool>& UnwalkableSpans)
+{
+	//Iterate through all the base span of the occupied part of the row
+	for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
+	{
+		uint32 CurrentIndex = SpanColumns.Columns[DepthIndex * Width + WidthIndex];
 
+		//Skip the empty columns
+		if (CurrentIndex == NULL_SPAN)
+		{
+			continue;
+		}
+
+		//As long as the current span has a next span valid
 		do 
 		{
+			const FHeightSpan& CurrentSpan = SpanColumns.Pool[CurrentIndex];
+			uint32 SpanIndex = CurrentIndex;
+			CurrentIndex = CurrentSpan.NextSpan;
+
 			//If already unwalkable, skip
-			if (CurrentSpan->SpanAttribute == PolygonType::UNWALKABLE)
+			if (CurrentSpan.Area == NULL_AREA)
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
 				continue;
 			}
 
 			//Find the height distance between the current and next span, if less than the MinTraversableHeight flag the current span as unwalkable
-			int SpanFloor = CurrentSpan->Max;
-			int SpanCeiling = (CurrentSpan->nextSpan) ? SpanCeiling = CurrentSpan->nextSpan->Min : SpanCeiling = INT_MAX;
+			int SpanFloor = CurrentSpan.Max;
+			int SpanCeiling = (CurrentSpan.NextSpan != NULL_SPAN) ? SpanColumns.Pool[CurrentSpan.NextSpan].Min : INT_MAX;
 
 			if ((SpanCeiling - SpanFloor) * CellHeight <= MinTraversableHeight)
 			{
-				CurrentSpan->SpanAttribute = PolygonType::UNWALKABLE;
+				UnwalkableSpans[SpanIndex] = true;
 			}
-
-			//To iterate through all the spans, let the current span become the next and repeat the loop until valid
-			CurrentSpan = CurrentSpan->nextSpan;
 		} 
 
-		while (CurrentSpan);
+		while (CurrentIndex != NULL_SPAN);
 	}
 }
 
-void USolidHeightfield::MarkLedgeSpan()
+void USolidHeightfield::MarkLedgeSpan(const int DepthIndex, TArray<bool>& UnwalkableSpans)
 {
-	//Iterate through all the base span
-	for (auto& Span : Spans)
+	//Iterate through all the base span of the occupied part of the row
+	for (int WidthIndex = RowWidthMin[DepthIndex]; WidthIndex <= RowWidthMax[DepthIndex]; WidthIndex++)
 	{
-		//As long as the current span has a next span valid
-		UHeightSpan* CurrentSpan = Span.Value;
+		uint32 CurrentIndex = SpanColumns.Columns[DepthIndex * Width + WidthIndex];
 
+		//Skip the empty columns
+		if (CurrentIndex == NULL_SPAN)
+		{
+			continue;
+		}
+
+		//The position of the span is implied by the column it belongs to
+		int SpanWidth = WidthIndex;
+		int SpanDepth = DepthIndex;
+
+		//As long as the current span has a next span valid
 		do {
+			const FHeightSpan& CurrentSpan = SpanColumns.Pool[CurrentIndex];
+			uint32 SpanIndex = CurrentIndex;
+			CurrentIndex = CurrentSpan.NextSpan;
+
 			//If already unwalkable, skip
-			if (CurrentSpan->SpanAttribute == PolygonType::UNWALKABLE)
+			if (CurrentSpan.Area == NULL_AREA || UnwalkableSpans[SpanIndex])
 			{
-				CurrentSpan = CurrentSpan->nextSpan;
 				continue;
 			}
 
-			int CurrentFloor = CurrentSpan->Max * CellHeight;
-			int CurrentCeiling = (CurrentSpan->nextSpan) ? CurrentCeiling = CurrentSpan->nextSpan->Min * CellHeight : CurrentCeiling = INT_MAX;
+			int CurrentFloor = CurrentSpan.Max * CellHeight;
+			int CurrentCeiling = (CurrentSpan.NextSpan != NULL_SPAN) ? int(SpanColumns.Pool[CurrentSpan.NextSpan].Min * CellHeight) : INT_MAX;
 
 			//Minimum height distance from a neightbor span in unit 
 			int MinHeightToNeightbor = INT_MAX;
@@ -607,26 +771,26 @@ void USolidHeightfield::MarkLedgeSpan()
 			//Find all the adjacent grid column to the one the span considered is in 
 			for (int NeightborDir = 0; NeightborDir < 4; NeightborDir++)
 			{
-				int NeighborWidth = CurrentSpan->Width + GetDirOffSetWidth(NeightborDir);
-				int NeightborDepth = CurrentSpan->Depth + GetDirOffSetDepth(NeightborDir);
+				int NeighborWidth = SpanWidth + GetDirOffSetWidth(NeightborDir);
+				int NeightborDepth = SpanDepth + GetDirOffSetDepth(NeightborDir);
 
 				int NeightborIndex = GetGridIndex(NeighborWidth, NeightborDepth);
 
 				//If one of the neightbor is not valid, the span considered is on a edge, therefore is not walkable
-				if (!Spans.Contains(NeightborIndex))
+				if (NeightborIndex == -1 || SpanColumns.Columns[NeightborIndex] == NULL_SPAN)
 				{
-					/*CurrentSpan->SpanAttribute = PolygonType::UNWALKABLE;
+					/*CurrentSpan.Area = NULL_AREA;
 					break;*/
 					MinHeightToNeightbor = FMath::Min(MinHeightToNeightbor, int(-MaxTraversableStep - CurrentFloor));
 					continue;
 				}
 
-				UHeightSpan* NeightborSpan = *Spans.Find(NeightborIndex);
+				uint32 NeightborSpanIndex = SpanColumns.Columns[NeightborIndex];
 
 				//Retrieve the data relative to the neightbor span (need also to take into account the area below the base span)
 				//Which is represented by the default value assigned below
 				int BaseNeightborFloor = -MaxTraversableStep;
-				int BaseNeightborCeiling = NeightborSpan->Min * CellHeight;
+				int BaseNeightborCeiling = SpanColumns.Pool[NeightborSpanIndex].Min * CellHeight;
 
 				if ((FMath::Min(CurrentCeiling, BaseNeightborCeiling) - CurrentFloor) > MinTraversableHeight)
 				{
@@ -635,27 +799,27 @@ void USolidHeightfield::MarkLedgeSpan()
 
 				do
 				{
-					BaseNeightborFloor = NeightborSpan->Max * CellHeight;
-					BaseNeightborCeiling = (NeightborSpan->nextSpan) ? BaseNeightborCeiling = NeightborSpan->nextSpan->Min * CellHeight : BaseNeightborCeiling = INT_MAX;
+					const FHeightSpan& NeightborSpan = SpanColumns.Pool[NeightborSpanIndex];
+
+					BaseNeightborFloor = NeightborSpan.Max * CellHeight;
+					BaseNeightborCeiling = (NeightborSpan.NextSpan != NULL_SPAN) ? int(SpanColumns.Pool[NeightborSpan.NextSpan].Min * CellHeight) : INT_MAX;
 
 					if (FMath::Min(CurrentCeiling, BaseNeightborCeiling) - FMath::Max(CurrentFloor, BaseNeightborFloor) > MinTraversableHeight)
 					{
 						MinHeightToNeightbor = FMath::Min(MinHeightToNeightbor, BaseNeightborFloor - CurrentFloor);
 					}
 
-					NeightborSpan = NeightborSpan->nextSpan;
+					NeightborSpanIndex = NeightborSpan.NextSpan;
 				} 
-				while (NeightborSpan);
+				while (NeightborSpanIndex != NULL_SPAN);
 			}
 
 			if (MinHeightToNeightbor < -MaxTraversableStep)
 			{
-				CurrentSpan->SpanAttribute = PolygonType::UNWALKABLE;
+				UnwalkableSpans[SpanIndex] = true;
 			}
-
-			CurrentSpan = CurrentSpan->nextSpan;
 		} 
-		while (CurrentSpan);
+		while (CurrentIndex != NULL_SPAN);
 	}
 }
 
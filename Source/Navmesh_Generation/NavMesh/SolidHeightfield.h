@@ -9,16 +9,77 @@
 
 class ANavMeshController;
 
-//Enum to specify the side of the box used in the calculation of the clipping algorithm
-UENUM()
-enum class BoxSide : uint8
+//Maximum number of vertices of a triangle clipped against the 4 sides of a cell (with some margin for the vertices on the cell sides)
+#define MAX_CLIPPED_VERTICES 12
+
+//Number of triangles processed together by the vectorized kernel, one per vector register lane
+#define TRIANGLE_BATCH_SIZE 4
+
+//Data of a triangle computed before splitting it into the heightfield cells
+USTRUCT()
+struct FTriangleRasterData
+{
+	GENERATED_USTRUCT_BODY()
+
+	//Area ID of the triangle based on its slope
+	uint8 Area = NULL_AREA;
+
+	//False if the triangle is completely outside of the grid
+	bool OverlapsField = false;
+
+	//First and last row covered by the triangle, -1 represents the area before the grid
+	int DepthMin = 0;
+
+	int DepthMax = 0;
+};
+
+//Area of the world rasterized into columns, either the whole heightfield or the local space of a voxel template
+USTRUCT()
+struct FVoxelGrid
 {
-	LEFT_FACE = 0	UMETA(DisplayName = "LEFT_FACE"),
-	RIGHT_FACE		UMETA(DisplayName = "RIGHT_FACE"),
-	TOP_FACE		UMETA(DisplayName = "TOP_FACE"),
-	BOTTOM_FACE		UMETA(DisplayName = "BOTTOM_FACE"),
-	FRONT_FACE		UMETA(DisplayName = "FRONT_FACE"),
-	BACK_FACE		UMETA(DisplayName = "BACK_FACE")
+	GENERATED_USTRUCT_BODY()
+
+	FVector BoundMin = FVector::ZeroVector;
+
+	FVector BoundMax = FVector::ZeroVector;
+
+	//Number of columns along the X and Y axis
+	int Width = 0;
+
+	int Depth = 0;
+};
+
+//Geometry of a mesh to voxelize, the axis aligned boxes are rasterized directly without being converted to triangles
+USTRUCT()
+struct FVoxelGeometry
+{
+	GENERATED_USTRUCT_BODY()
+
+	//Unique vertices of the triangles, every 3 indices define a triangle
+	TArray<FVector> Vertices;
+
+	TArray<int> Indices;
+
+	TArray<FBox> Boxes;
+
+	bool IsEmpty() const { return (Vertices.Num() == 0 || Indices.Num() == 0) && Boxes.Num() == 0; };
+
+	//Bounding box containing both the vertices and the boxes
+	FBox GetBounds() const;
+};
+
+/*Spans of a mesh voxelized in its local space (rotation and scale applied, translation excluded)
+  The template can be replayed into the heightfield for every instance of the mesh by offsetting it by an integer number of cells*/
+USTRUCT()
+struct FVoxelTemplate
+{
+	GENERATED_USTRUCT_BODY()
+
+	//Columns located in cells from the origin of the local space
+	FHeightSpanColumns Spans;
+
+	//Height in cells of the local space origin from the base of the spans
+	int OffsetHeight = 0;
 };
 
 UCLASS(NotBlueprintable, NotPlaceable)
@@ -29,31 +90,52 @@ class NAVMESH_GENERATION_API USolidHeightfield : public UBaseHeightfield
 public:	
 	void InitializeParameters(const ANavMeshController* NavController);
 
-	//Calculate the min and max bounds of the field based on the geometry vertices
-	void DefineFieldsBounds(const FVector AreaCenter, const FVector AreaExtent);
+	/*Calculate the min and max bounds of the field based on the geometry vertices
+	  The columns can be left unallocated when the bounds are only needed to define the grid, like for a build performed in chunks*/
+	void DefineFieldsBounds(const FVector AreaCenter, const FVector AreaExtent, const bool AllocateColumns = true);
+
+	/*Restrict the heightfield to an area of the field grid passed in (in grid coordinates, max excluded) and allocate its columns
+	  The grid of the area is aligned to the field one, so the spans can be copied to a heightfield covering the whole field*/
+	void DefineChunkBounds(const FVoxelGrid& FieldGrid, const FIntRect& Area);
 
-	//Define the voxel grid based on the geometry data taken by the mesh
-	void VoxelizeTriangles(const TArray<FVector>& Vertices, const TArray<int> Indices);
+	//Release all the columns and spans of the heightfield, the bounds are not modified
+	void ReleaseSpans();
 
-	void FindGeometryHeight(const TArray<FVector>& Vertices, float& MinHeight, float& MaxHeight);
+	/*Define the voxel grid based on the geometry data taken by the mesh
+	  The spans are written to the columns passed in, which are initialized to the area of the grid covered by the mesh
+	  The heightfield itself is not modified, so different meshes can be voxelized in parallel and merged afterwards through MergeSpans*/
+	void VoxelizeGeometry(const FVoxelGeometry& Geometry, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const;
 
-	/*Application of the Sutherland-Hodgman clipping algorithm - https://parksdigital.com/sutherland-hodgeman-polygon-clipping-algorithm.html
-	  The iteration through all the sides can be found inside the ClipPolygon method
-	  Rotation is not taken into account as the voxels are represented by AABB*/
-	void ClipVersusPlane(TArray<FVector>& Vertices, const FVector MinBound, const FVector MaxBound, const BoxSide Side);
+	//Voxelize a mesh in its local space, the geometry must not include the translation (apart from the offset inside the origin cell)
+	void VoxelizeTemplate(const FVoxelGeometry& Geometry, FVoxelTemplate& OutTemplate) const;
 
-	//Clip the polygon vertices passed in against the AABB box of size BoundMin, BoundMax
-	//By iterating through all the sides of the box
-	void ClipPolygon(TArray<FVector>& Vertices, const FVector MinBound, const FVector MaxBound);
+	//Rasterize the triangles of the geometry into the columns passed in
+	//The vertices are the unique (indexed) ones of the mesh, every 3 indices define a triangle
+	void VoxelizeTriangles(const TArray<FVector>& Vertices, const TArray<int>& Indices, const float FieldHeight, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const;
 
-	//Establish if the current vertex is inside the clipping plane specified by the "Side" parameter
-	int InsideClippingPlane(const FVector Vertex, const FVector MinBound, const FVector MaxBound, const BoxSide Side);
+	//Rasterize an axis aligned box, every column covered by the box receives a single span, walkable if the top face is
+	void RasterizeBox(const FBox& Box, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const;
 
-	//Find the intersection between the line and the plane specified by the "Side" parameter
-	FVector FindPlaneIntersection(const FVector V0, const FVector V1, const FVector MinBound, const FVector MaxBound, const BoxSide Side);
+	//Find the type and the rows covered by a single triangle
+	void PrepareTriangle(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC, const FVoxelGrid& Grid, FTriangleRasterData& OutData) const;
+
+	/*Vectorized version of PrepareTriangle processing TRIANGLE_BATCH_SIZE triangles at once
+	  The vertices are passed as 16 bytes aligned structure of arrays (AX, AY, AZ, BX, BY, BZ, CX, CY, CZ), TRIANGLE_BATCH_SIZE values each
+	  Only the first BatchCount results are written*/
+	void PrepareTriangleBatch(const float* BatchVertices, const int BatchCount, const FVoxelGrid& Grid, FTriangleRasterData* OutData) const;
+
+	//Rasterize a single triangle into the grid spans, the triangle is first split into rows and then each row into cells
+	//so that only the cells actually covered by the triangle are processed (same approach used by Recast)
+	void RasterizeTriangle(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC, const FTriangleRasterData& TriangleData, const float FieldHeight, const FVoxelGrid& Grid, FHeightSpanColumns& OutSpans) const;
+
+	/*Divide the polygon passed in along the line perpendicular to the axis specified (0 = X, 1 = Y) located at AxisOffset
+	  The part of the polygon below the line is stored in OutVertices1, the part above in OutVertices2
+	  The output buffers must be able to contain MAX_CLIPPED_VERTICES vertices*/
+	void DividePolygon(const FVector* InVertices, const int InCount, FVector* OutVertices1, int& OutCount1, FVector* OutVertices2, int& OutCount2, const float AxisOffset, const int Axis) const;
 
 	//Filter the walkable polygon from the unwalkable ones by checking against the maximum slope allowed
-	PolygonType FilterWalkablePolygon(const TArray<FVector>& Vertices);
+	//Return WALKABLE_AREA for the walkable polygons, NULL_AREA otherwise
+	uint8 FilterWalkablePolygon(const FVector& VertexA, const FVector& VertexB, const FVector& VertexC) const;
 
 	/*Calculation of the up normal, based on the Dihedral angle formula - https://mathworld.wolfram.com/DihedralAngle.html
 	  It assumes that one of the plane is perpendicular to the up axis and takes the MaxTraversableAngle as reference angle*/
@@ -61,20 +143,35 @@ public:
 
 	/*Add span data to the heightfield, the new span is either merged into existing spans or a new span is created
 	  Return true if the data is successfully added, otherwise false*/
-	bool AddSpanData(int WidthIndex, int DepthIndex, int HeightIndexMin, int HeightIndexMax, PolygonType Type);
+	bool AddSpanData(int WidthIndex, int DepthIndex, int HeightIndexMin, int HeightIndexMax, uint8 Area);
+
+	//Add the spans of a voxelized mesh to the heightfield, using the same merge rules of AddSpanData
+	void MergeSpans(const FHeightSpanColumns& MeshSpans);
+
+	/*Add the spans of a voxel template to the heightfield, the template origin is placed at the corner of the cell passed in (in grid coordinates)
+	  The template columns are rotated by 90 degrees around the origin for every quarter turn*/
+	void MergeTemplate(const FVoxelTemplate& Template, const FIntVector& Cell, const int QuarterTurns);
+
+	//Grid covering the whole heightfield
+	FVoxelGrid GetFieldGrid() const;
 
 	//Draw the debug data relative to the spans composing the geometry
 	void DrawDebugSpanData();
 
-	//Remove the traversable flag from spans that have another span too close above them specified by MinTraversableHeight
-	void MarkLowHeightSpan();
+	//Run the span filters below on the whole heightfield, to be performed once all the geometries have been voxelized
+	//The rows are processed in parallel and the results applied at the end
+	void FilterSpans();
 
-	//Remove the traversable flag from spans that are close to a drop greater than the specified MaxTraversableStep
-	void MarkLedgeSpan();
+	//Flag the spans of the row that have another span too close above them specified by MinTraversableHeight
+	void MarkLowHeightSpan(const int DepthIndex, TArray<bool>& UnwalkableSpans);
+
+	//Flag the spans of the row that are close to a drop greater than the specified MaxTraversableStep
+	void MarkLedgeSpan(const int DepthIndex, TArray<bool>& UnwalkableSpans);
 
 	const FVector GetBoundMin() const { return BoundMin; };
 	const FVector GetBoundMax() const { return BoundMax; };
-	const TMap<int, UHeightSpan*> GetSpans() const { return Spans; };
+	const TArray<uint32>& GetSpans() const { return SpanColumns.Columns; };
+	const FHeightSpanPool& GetSpanPool() const { return SpanColumns.Pool; };
 
 private:
 	//Represent the plane normal calculated based on the MaxTraversableAngle
@@ -83,7 +180,9 @@ private:
 
 	float MaxTraversableAngle;
 
-	//Container of all the spans contained in the heightfield
-	UPROPERTY()
-	TMap<int, UHeightSpan*> Spans;
+	//Use the vectorized kernel to prepare the triangles before the rasterization
+	bool EnableVectorization;
+
+	//Columns of spans covering the whole heightfield grid
+	FHeightSpanColumns SpanColumns;
 };
@@ -4,3 +4,5 @@
 
 #include "CoreMinimal.h"
 
+//Stats used to profile the single stages of the navmesh generation - use "stat NavMeshGeneration" to display them
+DECLARE_STATS_GROUP(TEXT("NavMeshGeneration"), STATGROUP_NavMeshGeneration, STATCAT_Advanced);
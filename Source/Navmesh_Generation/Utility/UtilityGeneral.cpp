@@ -2,4 +2,152 @@
 
 
 #include "UtilityGeneral.h"
+#include "Engine/StaticMesh.h"
+#include "PhysicsEngine/BodySetup.h"
 
+//Number of segments used to approximate the circumference of the capsules, and of rings for every half sphere
+#define CAPSULE_SEGMENTS 8
+#define CAPSULE_RINGS 2
+
+void UUtilityGeneral::GetStaticMeshSimpleCollision(const UStaticMesh* StaticMesh, const FTransform& Transform, TArray<FVector>& Vertices, TArray<int>& Indexes, TArray<FBox>& Boxes)
+{
+	if (!StaticMesh || !StaticMesh->GetBodySetup())
+	{
+		return;
+	}
+
+	const FKAggregateGeom& AggGeom = StaticMesh->GetBodySetup()->AggGeom;
+
+	//Corners of a unit box, the triangles are listed so that the slope test (AC x AB) returns the outward normal
+	static const FVector BoxCorners[8] = {
+		FVector(-1, -1, -1), FVector(1, -1, -1), FVector(1, 1, -1), FVector(-1, 1, -1),
+		FVector(-1, -1, 1), FVector(1, -1, 1), FVector(1, 1, 1), FVector(-1, 1, 1) };
+
+	static const int BoxIndexes[36] = {
+		0, 1, 2, 0, 2, 3,
+		4, 6, 5, 4, 7, 6,
+		0, 5, 1, 0, 4, 5,
+		1, 6, 2, 1, 5, 6,
+		2, 7, 3, 2, 6, 7,
+		3, 4, 0, 3, 7, 4 };
+
+	for (const FKBoxElem& Box : AggGeom.BoxElems)
+	{
+		const FTransform BoxTransform = Box.GetTransform() * Transform;
+		const FVector HalfExtent(Box.X * 0.5f, Box.Y * 0.5f, Box.Z * 0.5f);
+
+		//The box is still axis aligned if every local axis is mapped onto a world axis
+		const FVector AxisX = BoxTransform.GetUnitAxis(EAxis::X).GetAbs();
+		const FVector AxisY = BoxTransform.GetUnitAxis(EAxis::Y).GetAbs();
+		const FVector AxisZ = BoxTransform.GetUnitAxis(EAxis::Z).GetAbs();
+		const float AlignmentTolerance = 1.f - KINDA_SMALL_NUMBER;
+
+		if (AxisX.GetMax() >= AlignmentTolerance && AxisY.GetMax() >= AlignmentTolerance && AxisZ.GetMax() >= AlignmentTolerance)
+		{
+			FBox AlignedBox(ForceInit);
+
+			for (const FVector& Corner : BoxCorners)
+			{
+				AlignedBox += BoxTransform.TransformPosition(Corner * HalfExtent);
+			}
+
+			Boxes.Add(AlignedBox);
+			continue;
+		}
+
+		int FirstVertex = Vertices.Num();
+
+		for (const FVector& Corner : BoxCorners)
+		{
+			Vertices.Add(BoxTransform.TransformPosition(Corner * HalfExtent));
+		}
+
+		for (int Index : BoxIndexes)
+		{
+			Indexes.Add(FirstVertex + Index);
+		}
+	}
+
+	for (const FKSphereElem& Sphere : AggGeom.SphereElems)
+	{
+		AddCapsuleTriangles(Sphere.GetTransform() * Transform, Sphere.Radius, 0.f, Vertices, Indexes);
+	}
+
+	for (const FKSphylElem& Sphyl : AggGeom.SphylElems)
+	{
+		AddCapsuleTriangles(Sphyl.GetTransform() * Transform, Sphyl.Radius, Sphyl.Length, Vertices, Indexes);
+	}
+
+	for (const FKConvexElem& Convex : AggGeom.ConvexElems)
+	{
+		//The index data is generated together with the convex hull, convexes without it can't be triangulated
+		if (Convex.IndexData.Num() == 0)
+		{
+			continue;
+		}
+
+		const FTransform ConvexTransform = Convex.GetTransform() * Transform;
+		int FirstVertex = Vertices.Num();
+
+		for (const FVector& Vertex : Convex.VertexData)
+		{
+			Vertices.Add(ConvexTransform.TransformPosition(Vertex));
+		}
+
+		for (int32 Index : Convex.IndexData)
+		{
+			Indexes.Add(FirstVertex + Index);
+		}
+	}
+}
+
+void UUtilityGeneral::AddCapsuleTriangles(const FTransform& Transform, const float Radius, const float Length, TArray<FVector>& Vertices, TArray<int>& Indexes)
+{
+	int FirstVertex = Vertices.Num();
+
+	//Bottom and top pole
+	Vertices.Add(Transform.TransformPosition(FVector(0.f, 0.f, -Length * 0.5f - Radius)));
+	Vertices.Add(Transform.TransformPosition(FVector(0.f, 0.f, Length * 0.5f + Radius)));
+
+	//Rings from the bottom to the top, the rings of each half sphere are offset by half of the capsule length
+	const int RingCount = CAPSULE_RINGS * 2;
+
+	for (int Ring = 0; Ring < RingCount; Ring++)
+	{
+		bool IsTopHalf = Ring >= CAPSULE_RINGS;
+		float Angle = PI * 0.5f * (Ring + (IsTopHalf ? 0 : 1)) / CAPSULE_RINGS - PI * 0.5f;
+		float RingRadius = Radius * FMath::Cos(Angle);
+		float RingHeight = Radius * FMath::Sin(Angle) + (IsTopHalf ? Length * 0.5f : -Length * 0.5f);
+
+		for (int Segment = 0; Segment < CAPSULE_SEGMENTS; Segment++)
+		{
+			float SegmentAngle = 2.f * PI * Segment / CAPSULE_SEGMENTS;
+			Vertices.Add(Transform.TransformPosition(FVector(RingRadius * FMath::Cos(SegmentAngle), RingRadius * FMath::Sin(SegmentAngle), RingHeight)));
+		}
+	}
+
+	const int BottomPole = FirstVertex;
+	const int TopPole = FirstVertex + 1;
+	const int FirstRing = FirstVertex + 2;
+
+	for (int Segment = 0; Segment < CAPSULE_SEGMENTS; Segment++)
+	{
+		int NextSegment = (Segment + 1) % CAPSULE_SEGMENTS;
+
+		//Fan connecting the poles to the first and last ring
+		Indexes.Append({ BottomPole, FirstRing + Segment, FirstRing + NextSegment });
+
+		int LastRing = FirstRing + (RingCount - 1) * CAPSULE_SEGMENTS;
+		Indexes.Append({ TopPole, LastRing + NextSegment, LastRing + Segment });
+
+		//Quads between consecutive rings
+		for (int Ring = 0; Ring < RingCount - 1; Ring++)
+		{
+			int Lower = FirstRing + Ring * CAPSULE_SEGMENTS;
+			int Upper = Lower + CAPSULE_SEGMENTS;
+
+			Indexes.Append({ Lower + Segment, Upper + NextSegment, Lower + NextSegment });
+			Indexes.Append({ Lower + Segment, Upper + Segment, Upper + NextSegment });
+		}
+	}
+}
@@ -14,43 +14,88 @@ class NAVMESH_GENERATION_API UUtilityGeneral : public UBlueprintFunctionLibrary
 public:
 	/*
 	* Return the vertices of a mesh without duplicates
+	* The LOD index is clamped to the LODs available in the render data
 	*/
 	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get the indexed vertices of a mesh"))
-		static void GetMeshIndexedVertices(const UStaticMeshComponent* Mesh, TArray<FVector>& Vertices) 
+		static void GetMeshIndexedVertices(const UStaticMeshComponent* Mesh, TArray<FVector>& Vertices, const int LODIndex = 0) 
 	{
 		if (!Mesh)
 		{
 			return;
 		}
 
-		FPositionVertexBuffer* VertexBuffer = &Mesh->GetStaticMesh()->GetRenderData()->LODResources[0].VertexBuffers.PositionVertexBuffer;
+		int FirstVertex = Vertices.Num();
+		GetStaticMeshLocalVertices(Mesh->GetStaticMesh(), Vertices, LODIndex);
+
+		//The transform is the same for all the vertices, retrieve it only once
+		//The component transform is used so that meshes that are not the root of their actor are placed correctly
+		const FTransform OwnerTransform = Mesh->GetComponentTransform();
+
+		for (int32 It = FirstVertex; It < Vertices.Num(); It++)
+		{
+			//Converts the UStaticMesh vertex translation, rotation, and scaling in world space
+			Vertices[It] = OwnerTransform.TransformPosition(Vertices[It]);
+		}
+	}
+
+	/*
+	* Return the vertices of a static mesh asset without duplicates, in the local space of the mesh
+	* The LOD index is clamped to the LODs available in the render data
+	*/
+	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get the indexed vertices of a static mesh in local space"))
+		static void GetStaticMeshLocalVertices(const UStaticMesh* StaticMesh, TArray<FVector>& Vertices, const int LODIndex = 0)
+	{
+		if (!StaticMesh || !StaticMesh->GetRenderData() || StaticMesh->GetRenderData()->LODResources.Num() == 0)
+		{
+			return;
+		}
+
+		const TIndirectArray<FStaticMeshLODResources>& LODResources = StaticMesh->GetRenderData()->LODResources;
+		const FPositionVertexBuffer* VertexBuffer = &LODResources[FMath::Clamp(LODIndex, 0, LODResources.Num() - 1)].VertexBuffers.PositionVertexBuffer;
 
 		//Iterate through all the vertices
 		int32 VertexCount = VertexBuffer->GetNumVertices();
+		Vertices.Reserve(Vertices.Num() + VertexCount);
+
 		for (int32 It = 0; It < VertexCount; It++)
 		{
-			const FVector VertexLocalPos = VertexBuffer->VertexPosition(It);
-
-			//Converts the UStaticMesh vertex translation, rotation, and scaling in world space
-			const FVector VertexWorldPos = Mesh->GetOwner()->GetActorLocation() + Mesh->GetOwner()->GetTransform().TransformVector(VertexLocalPos);;
-			Vertices.Add(VertexWorldPos);
+			Vertices.Add(VertexBuffer->VertexPosition(It));
 		}
 	}
 
 	/*
 	* Return the indexes of a mesh 
+	* The LOD index is clamped to the LODs available in the render data
 	*/
 	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get the indexes of a mesh"))
-		static void GetMeshIndices(const UStaticMeshComponent* Mesh, TArray<int>& Indexes)
+		static void GetMeshIndices(const UStaticMeshComponent* Mesh, TArray<int>& Indexes, const int LODIndex = 0)
 	{
 		if (!Mesh)
 		{
 			return;
 		}
 
-		FRawStaticIndexBuffer* IndexBuffers = &Mesh->GetStaticMesh()->GetRenderData()->LODResources[0].IndexBuffer;
+		GetStaticMeshIndices(Mesh->GetStaticMesh(), Indexes, LODIndex);
+	}
+
+	/*
+	* Return the indexes of a static mesh asset
+	* The LOD index is clamped to the LODs available in the render data
+	*/
+	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get the indexes of a static mesh"))
+		static void GetStaticMeshIndices(const UStaticMesh* StaticMesh, TArray<int>& Indexes, const int LODIndex = 0)
+	{
+		if (!StaticMesh || !StaticMesh->GetRenderData() || StaticMesh->GetRenderData()->LODResources.Num() == 0)
+		{
+			return;
+		}
+
+		const TIndirectArray<FStaticMeshLODResources>& LODResources = StaticMesh->GetRenderData()->LODResources;
+		const FRawStaticIndexBuffer* IndexBuffers = &LODResources[FMath::Clamp(LODIndex, 0, LODResources.Num() - 1)].IndexBuffer;
 
 		int32 IndexCount = IndexBuffers->GetNumIndices();
+		Indexes.Reserve(Indexes.Num() + IndexCount);
+
 		for (int32 I = 0; I < IndexCount; I++)
 		{
 			const int Index = IndexBuffers->GetIndex(I);
@@ -58,8 +103,22 @@ public:
 		}
 	}
 
+	/*
+	* Return the simple collision of a static mesh asset (boxes, spheres, capsules and convexes) transformed by the transform passed in
+	* The boxes that are still axis aligned after the transformation are returned as AABB, all the other shapes are converted to triangles
+	*/
+	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get the simple collision geometry of a static mesh"))
+		static void GetStaticMeshSimpleCollision(const UStaticMesh* StaticMesh, const FTransform& Transform, TArray<FVector>& Vertices, TArray<int>& Indexes, TArray<FBox>& Boxes);
+
+	/*
+	* Append a triangulated capsule, aligned to the local Z axis, to the vertices and indexes passed in
+	* A sphere is a capsule with no length
+	*/
+	static void AddCapsuleTriangles(const FTransform& Transform, const float Radius, const float Length, TArray<FVector>& Vertices, TArray<int>& Indexes);
+
 	/*
 	* Get all the vertices of a mesh with duplicates
+	* Prefer GetMeshIndexedVertices + GetMeshIndices when the index buffer can be used, as this triples the vertex count
 	*/
 	UFUNCTION(BlueprintCallable, Category = StaticMesh, meta = (ToolTip = "Get all the vertices of a mesh"))
 		static void GetAllMeshVertices(const UStaticMeshComponent* Mesh, TArray<FVector>& Vertices)